@@ -86,7 +86,6 @@ void execute_sensor_measurement() {
     // file 0x40 is configured to use D7AActP trigger an ALP action which 
     // broadcasts this file data on Access Class 0
     fs_write_file(0x40, 0, (uint8_t*)&val, 4);
-    timer_post_task_delay(&execute_sensor_measurement, REPORTING_INTERVAL_TICKS);
 }
 
 
@@ -203,7 +202,7 @@ void bootstrap() {
     d7ap_stack_init(&fs_init_args, &d7asp_init_args, true, NULL);
 
     sched_register_task(&execute_sensor_measurement);
-    timer_post_task_delay(&execute_sensor_measurement, REPORTING_INTERVAL_TICKS);
+    timer_post_task_periodic(&execute_sensor_measurement, timer_get_counter_value() + REPORTING_INTERVAL_TICKS, REPORTING_INTERVAL_TICKS, 0, DEFAULT_PRIORITY);
 
 #if HW_NUM_LEDS > 0
     sched_register_task(&led_blink_off);
@@ -0,0 +1,43 @@
+# 
+# OSS-7 - An opensource implementation of the DASH7 Alliance Protocol for ultra
+# lowpower wireless sensor communication
+#
+# Copyright 2015 University of Antwerp
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+
+#Runs the simulator (SIMULATOR) with 1, 2 and 4 worker threads and checks that the statistics of the
+#medium are the same: the results of a simulation should not depend on the number of workers
+#Usage: cmake -DSIMULATOR=<d7ap_test.elf> -P sim_workers.cmake
+
+FOREACH(__workers 1 2 4)
+    EXECUTE_PROCESS(COMMAND ${SIMULATOR} -n 50 -t 10 -s 7 -j ${__workers}
+                    OUTPUT_QUIET ERROR_VARIABLE __output RESULT_VARIABLE __result)
+    IF(NOT __result EQUAL 0)
+        MESSAGE(FATAL_ERROR "the simulation with ${__workers} worker(s) failed:\n${__output}")
+    ENDIF()
+
+    STRING(REGEX MATCHALL "medium:[^\n]*" __medium "${__output}")
+    IF(NOT __medium)
+        MESSAGE(FATAL_ERROR "the simulation with ${__workers} worker(s) reported no statistics:\n${__output}")
+    ENDIF()
+
+    IF(NOT DEFINED __reference)
+        SET(__reference "${__medium}")
+    ELSEIF(NOT __medium STREQUAL __reference)
+        MESSAGE(FATAL_ERROR "the statistics with ${__workers} workers differ from those with 1 worker:\n${__medium}\n${__reference}")
+    ENDIF()
+
+    MESSAGE("${__workers} worker(s): ${__medium}")
+ENDFOREACH()
@@ -114,8 +114,6 @@ void execute_sensor_measurement()
   timer_tick_t t = timer_get_counter_value();
   fs_write_file(SENSOR_FILE_ID, 0, (uint8_t*)&t, sizeof(timer_tick_t));
 #endif
-
-  timer_post_task_delay(&execute_sensor_measurement, SENSOR_UPDATE);
 }
 
 void init_user_files()
@@ -211,7 +209,7 @@ void bootstrap()
 
     sched_register_task(&execute_sensor_measurement);
 
-    timer_post_task_delay(&execute_sensor_measurement, TIMER_TICKS_PER_SEC);
+    timer_post_task_periodic(&execute_sensor_measurement, timer_get_counter_value() + TIMER_TICKS_PER_SEC, SENSOR_UPDATE, SENSOR_UPDATE / 16, DEFAULT_PRIORITY);
 
     LCD_WRITE_STRING("EFM32 Sensor\n");
 }
@@ -370,7 +370,6 @@ void measureTemperature()
 
 void execute_sensor_measurement()
 {
-	timer_post_task_delay(&execute_sensor_measurement, TEMPERATURE_PERIOD);
 	measureTemperature();
 }
 
@@ -400,7 +399,7 @@ void bootstrap()
     timer_post_task_delay(&start_rx, TIMER_TICKS_PER_SEC * 3);
 
     sched_register_task((&execute_sensor_measurement));
-    timer_post_task_delay(&execute_sensor_measurement, TEMPERATURE_PERIOD);
+    timer_post_task_periodic(&execute_sensor_measurement, timer_get_counter_value() + TEMPERATURE_PERIOD, TEMPERATURE_PERIOD, TEMPERATURE_PERIOD / 16, DEFAULT_PRIORITY);
 
     measureTemperature();
 }
@@ -0,0 +1,30 @@
+# 
+# OSS-7 - An opensource implementation of the DASH7 Alliance Protocol for ultra
+# lowpower wireless sensor communication
+#
+# Copyright 2015 University of Antwerp
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+
+#######################################
+# Toolchain setup host-gcc
+#######################################
+
+# Native toolchain: builds the stack as a regular process for the build host,
+# to be used together with the 'posix' platform (see framework/hal/platforms/posix)
+
+SET(CMAKE_C_COMPILER   "gcc" CACHE STRING "The host C compiler")
+SET(CMAKE_CXX_COMPILER "g++" CACHE STRING "The host C++ compiler")
+
+MESSAGE(STATUS "Compiling for the build host using host-gcc toolchain")
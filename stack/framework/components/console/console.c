@@ -8,33 +8,38 @@
 #include "fifo.h"
 #include "scheduler.h"
 #include "console.h"
+#include "ng.h"
 
 #ifdef FRAMEWORK_CONSOLE_ENABLED
 
 #define TX_FIFO_FLUSH_CHUNK_SIZE 10 // at a baudrate of 115200 this ensures completion within 1 ms
                                     // TODO baudrate dependent
 
-static uart_handle_t* uart;
+static uart_handle_t* NGDEF(_uart);
+#define uart NG(_uart)
 
 #define CONSOLE_TX_FIFO_SIZE 255
-static uint8_t console_tx_buffer[CONSOLE_TX_FIFO_SIZE];
-static fifo_t console_tx_fifo;
+static uint8_t NGDEF(_console_tx_buffer)[CONSOLE_TX_FIFO_SIZE];
+#define console_tx_buffer NG(_console_tx_buffer)
+
+static fifo_t NGDEF(_console_tx_fifo);
+#define console_tx_fifo NG(_console_tx_fifo)
 
 static void flush_console_tx_fifo() {
   // only send small chunks over uart each invocation, to make sure
   // we don't interfer with critical stack timings.
   // When there is still data left in the fifo this will be rescheduled
-  // with lowest prio
-  uint8_t chunk[TX_FIFO_FLUSH_CHUNK_SIZE];
-  uint8_t depth = fifo_get_size(&console_tx_fifo);
-  if(depth < 10) {
-    fifo_pop(&console_tx_fifo, chunk, depth);
-    uart_send_bytes(uart, chunk, depth);
-  } else {
-    fifo_pop(&console_tx_fifo, chunk, TX_FIFO_FLUSH_CHUNK_SIZE);
-    uart_send_bytes(uart, chunk, TX_FIFO_FLUSH_CHUNK_SIZE);
+  // with lowest prio.
+  // The bytes are sent from the fifo buffer in place.
+  uint8_t* chunk;
+  uint16_t length = fifo_peek_contiguous(&console_tx_fifo, &chunk);
+  if(length > TX_FIFO_FLUSH_CHUNK_SIZE)
+    length = TX_FIFO_FLUSH_CHUNK_SIZE;
+
+  uart_send_bytes(uart, chunk, length);
+  fifo_skip(&console_tx_fifo, length);
+  if(fifo_get_size(&console_tx_fifo) > 0)
     sched_post_task_prio(&flush_console_tx_fifo, MIN_PRIORITY);
-  }
 }
 
 void console_init(void) {
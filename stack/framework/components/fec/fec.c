@@ -23,40 +23,81 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
-#include <stdio.h>
-#include <stdint.h>
 #include <string.h>
 
 #include "fec.h"
 
-#define INITIAL_FECSTATE 0x00
 #define TRELLIS_TERMINATOR 0x0B
-#define FEC_BUFFER_SIZE 128
-
-#define INTERLEAVING
+#define UNREACHABLE_STATE_COST 100
+#define PN9_PERIOD 511
 
 //#ifdef D7_PHY_USE_FEC
 
 const static uint8_t fec_lut[16] = {0, 3, 1, 2, 3, 0, 2, 1, 3, 0, 2, 1, 0, 3, 1, 2};
-const static uint8_t trellis0_lut[8] = {0, 1, 3, 2, 3, 2, 0, 1};
-const static uint8_t trellis1_lut[8] = {3, 2, 0, 1, 0, 1, 3, 2};
-
-static uint8_t data_buffer[FEC_BUFFER_SIZE];
-static uint8_t* input_buffer;
-static uint8_t* output_buffer;
-
-static uint8_t packetlength;
-static uint16_t fecpacketlength;
-static uint16_t output_packet_length;
 
-static uint8_t processedbytes;
-static uint16_t fecprocessedbytes;
-
-static uint16_t pn9;
-static uint16_t fecstate;
-static VITERBISTATE vstate;
-
-static bool fec_decode(uint8_t* input);
+// symbol_lut[x] are the 4 symbols sent for input bits 3 to 0 of x, given the 3 previous bits (the encoder state) in
+// bits 6 to 4 of x. Symbol j (fec_lut[(x >> j) & 0x0F]) is in bits 2j and 2j + 1
+const static uint8_t symbol_lut[128] = {
+	0x00, 0x03, 0x0D, 0x0E, 0x37, 0x34, 0x3A, 0x39, 0xDF, 0xDC, 0xD2, 0xD1, 0xE8, 0xEB, 0xE5, 0xE6,
+	0x7C, 0x7F, 0x71, 0x72, 0x4B, 0x48, 0x46, 0x45, 0xA3, 0xA0, 0xAE, 0xAD, 0x94, 0x97, 0x99, 0x9A,
+	0xF0, 0xF3, 0xFD, 0xFE, 0xC7, 0xC4, 0xCA, 0xC9, 0x2F, 0x2C, 0x22, 0x21, 0x18, 0x1B, 0x15, 0x16,
+	0x8C, 0x8F, 0x81, 0x82, 0xBB, 0xB8, 0xB6, 0xB5, 0x53, 0x50, 0x5E, 0x5D, 0x64, 0x67, 0x69, 0x6A,
+	0xC0, 0xC3, 0xCD, 0xCE, 0xF7, 0xF4, 0xFA, 0xF9, 0x1F, 0x1C, 0x12, 0x11, 0x28, 0x2B, 0x25, 0x26,
+	0xBC, 0xBF, 0xB1, 0xB2, 0x8B, 0x88, 0x86, 0x85, 0x63, 0x60, 0x6E, 0x6D, 0x54, 0x57, 0x59, 0x5A,
+	0x30, 0x33, 0x3D, 0x3E, 0x07, 0x04, 0x0A, 0x09, 0xEF, 0xEC, 0xE2, 0xE1, 0xD8, 0xDB, 0xD5, 0xD6,
+	0x4C, 0x4F, 0x41, 0x42, 0x7B, 0x78, 0x76, 0x75, 0x93, 0x90, 0x9E, 0x9D, 0xA4, 0xA7, 0xA9, 0xAA
+};
+
+// The PN9 sequence (x^9 + x^5 + 1, seed 0x1FF) repeats every 511 bytes. The first 3 bytes are repeated at the end,
+// so 4 bytes can be read from any position
+const static uint8_t pn9_keystream[PN9_PERIOD + 3] = {
+	0xFF, 0xE1, 0x1D, 0x9A, 0xED, 0x85, 0x33, 0x24, 0xEA, 0x7A, 0xD2, 0x39, 0x70, 0x97, 0x57, 0x0A,
+	0x54, 0x7D, 0x2D, 0xD8, 0x6D, 0x0D, 0xBA, 0x8F, 0x67, 0x59, 0xC7, 0xA2, 0xBF, 0x34, 0xCA, 0x18,
+	0x30, 0x53, 0x93, 0xDF, 0x92, 0xEC, 0xA7, 0x15, 0x8A, 0xDC, 0xF4, 0x86, 0x55, 0x4E, 0x18, 0x21,
+	0x40, 0xC4, 0xC4, 0xD5, 0xC6, 0x91, 0x8A, 0xCD, 0xE7, 0xD1, 0x4E, 0x09, 0x32, 0x17, 0xDF, 0x83,
+	0xFF, 0xF0, 0x0E, 0xCD, 0xF6, 0xC2, 0x19, 0x12, 0x75, 0x3D, 0xE9, 0x1C, 0xB8, 0xCB, 0x2B, 0x05,
+	0xAA, 0xBE, 0x16, 0xEC, 0xB6, 0x06, 0xDD, 0xC7, 0xB3, 0xAC, 0x63, 0xD1, 0x5F, 0x1A, 0x65, 0x0C,
+	0x98, 0xA9, 0xC9, 0x6F, 0x49, 0xF6, 0xD3, 0x0A, 0x45, 0x6E, 0x7A, 0xC3, 0x2A, 0x27, 0x8C, 0x10,
+	0x20, 0x62, 0xE2, 0x6A, 0xE3, 0x48, 0xC5, 0xE6, 0xF3, 0x68, 0xA7, 0x04, 0x99, 0x8B, 0xEF, 0xC1,
+	0x7F, 0x78, 0x87, 0x66, 0x7B, 0xE1, 0x0C, 0x89, 0xBA, 0x9E, 0x74, 0x0E, 0xDC, 0xE5, 0x95, 0x02,
+	0x55, 0x5F, 0x0B, 0x76, 0x5B, 0x83, 0xEE, 0xE3, 0x59, 0xD6, 0xB1, 0xE8, 0x2F, 0x8D, 0x32, 0x06,
+	0xCC, 0xD4, 0xE4, 0xB7, 0x24, 0xFB, 0x69, 0x85, 0x22, 0x37, 0xBD, 0x61, 0x95, 0x13, 0x46, 0x08,
+	0x10, 0x31, 0x71, 0xB5, 0x71, 0xA4, 0x62, 0xF3, 0x79, 0xB4, 0x53, 0x82, 0xCC, 0xC5, 0xF7, 0xE0,
+	0x3F, 0xBC, 0x43, 0xB3, 0xBD, 0x70, 0x86, 0x44, 0x5D, 0x4F, 0x3A, 0x07, 0xEE, 0xF2, 0x4A, 0x81,
+	0xAA, 0xAF, 0x05, 0xBB, 0xAD, 0x41, 0xF7, 0xF1, 0x2C, 0xEB, 0x58, 0xF4, 0x97, 0x46, 0x19, 0x03,
+	0x66, 0x6A, 0xF2, 0x5B, 0x92, 0xFD, 0xB4, 0x42, 0x91, 0x9B, 0xDE, 0xB0, 0xCA, 0x09, 0x23, 0x04,
+	0x88, 0x98, 0xB8, 0xDA, 0x38, 0x52, 0xB1, 0xF9, 0x3C, 0xDA, 0x29, 0x41, 0xE6, 0xE2, 0x7B, 0xF0,
+	0x1F, 0xDE, 0xA1, 0xD9, 0x5E, 0x38, 0x43, 0xA2, 0xAE, 0x27, 0x9D, 0x03, 0x77, 0x79, 0xA5, 0x40,
+	0xD5, 0xD7, 0x82, 0xDD, 0xD6, 0xA0, 0xFB, 0x78, 0x96, 0x75, 0x2C, 0xFA, 0x4B, 0xA3, 0x8C, 0x01,
+	0x33, 0x35, 0xF9, 0x2D, 0xC9, 0x7E, 0x5A, 0xA1, 0xC8, 0x4D, 0x6F, 0x58, 0xE5, 0x84, 0x11, 0x02,
+	0x44, 0x4C, 0x5C, 0x6D, 0x1C, 0xA9, 0xD8, 0x7C, 0x1E, 0xED, 0x94, 0x20, 0x73, 0xF1, 0x3D, 0xF8,
+	0x0F, 0xEF, 0xD0, 0x6C, 0x2F, 0x9C, 0x21, 0x51, 0xD7, 0x93, 0xCE, 0x81, 0xBB, 0xBC, 0x52, 0xA0,
+	0xEA, 0x6B, 0xC1, 0x6E, 0x6B, 0xD0, 0x7D, 0x3C, 0xCB, 0x3A, 0x16, 0xFD, 0xA5, 0x51, 0xC6, 0x80,
+	0x99, 0x9A, 0xFC, 0x96, 0x64, 0x3F, 0xAD, 0x50, 0xE4, 0xA6, 0x37, 0xAC, 0x72, 0xC2, 0x08, 0x01,
+	0x22, 0x26, 0xAE, 0x36, 0x8E, 0x54, 0x6C, 0x3E, 0x8F, 0x76, 0x4A, 0x90, 0xB9, 0xF8, 0x1E, 0xFC,
+	0x87, 0x77, 0x68, 0xB6, 0x17, 0xCE, 0x90, 0xA8, 0xEB, 0x49, 0xE7, 0xC0, 0x5D, 0x5E, 0x29, 0x50,
+	0xF5, 0xB5, 0x60, 0xB7, 0x35, 0xE8, 0x3E, 0x9E, 0x65, 0x1D, 0x8B, 0xFE, 0xD2, 0x28, 0x63, 0xC0,
+	0x4C, 0x4D, 0x7E, 0x4B, 0xB2, 0x9F, 0x56, 0x28, 0x72, 0xD3, 0x1B, 0x56, 0x39, 0x61, 0x84, 0x00,
+	0x11, 0x13, 0x57, 0x1B, 0x47, 0x2A, 0x36, 0x9F, 0x47, 0x3B, 0x25, 0xC8, 0x5C, 0x7C, 0x0F, 0xFE,
+	0xC3, 0x3B, 0x34, 0xDB, 0x0B, 0x67, 0x48, 0xD4, 0xF5, 0xA4, 0x73, 0xE0, 0x2E, 0xAF, 0x14, 0xA8,
+	0xFA, 0x5A, 0xB0, 0xDB, 0x1A, 0x74, 0x1F, 0xCF, 0xB2, 0x8E, 0x45, 0x7F, 0x69, 0x94, 0x31, 0x60,
+	0xA6, 0x26, 0xBF, 0x25, 0xD9, 0x4F, 0x2B, 0x14, 0xB9, 0xE9, 0x0D, 0xAB, 0x9C, 0x30, 0x42, 0x80,
+	0x88, 0x89, 0xAB, 0x8D, 0x23, 0x15, 0x9B, 0xCF, 0xA3, 0x9D, 0x12, 0x64, 0x2E, 0xBE, 0x07, 0xFF,
+	0xE1, 0x1D
+};
+
+// The decoder uses the trellis of the convolutional code: state k is reached with input bit k & 1, from
+// predecessor state k >> 1 or (k >> 1) + 4. States 2p and 2p + 1 share the predecessors p and p + 4 (a butterfly):
+// the transition from p to 2p sends the same symbol as the transition from p + 4 to 2p + 1, the other two
+// transitions send its complement.
+// branch_metric[symbol][p] is the Hamming distance between the received symbol and the symbol sent from p to 2p,
+// the distance to the complement is 2 - branch_metric[symbol][p]
+const static uint8_t branch_metric[4][4] = {
+	{0, 1, 2, 1},
+	{1, 0, 1, 2},
+	{1, 2, 1, 0},
+	{2, 1, 0, 1}
+};
 
 #if defined(FRAMEWORK_LOG_ENABLED) && defined(FRAMEWORK_PHY_LOG_ENABLED) // TODO more granular (LOG_PHY_ENABLED)
 #define DPRINT(...) log_print_stack_string(LOG_STACK_PHY, __VA_ARGS__)
@@ -66,340 +107,359 @@ static bool fec_decode(uint8_t* input);
 #define DPRINT_DATA(...)
 #endif
 
-//void print_array(uint8_t* buffer, uint8_t length)
-//	for (i = 0; i < length; i++)
-//void print_array(uint8_t* buffer, uint8_t length)
-//{
-//	int i = 0;
-//	for (; i < length; i++)
-//	{
-//	    printf("%02X", buffer[i]);
-//	}
-//	printf(" ");
-//
-//	for (i = 0; i < length; i++)
-//	{
-//		printf("%s", byte_to_binary(buffer[i]));
-//	}
-//}
-
-const char *int_to_binary(uint16_t x)
+void fec_pn9_init(fec_pn9_t* pn9)
 {
-    static char b[17];
-    b[0] = '\0';
-
-    uint16_t z;
-    for (z = 0x8000; z > 0; z >>= 1)
-    {
-        strcat(b, ((x & z) == z) ? "1" : "0");
-    }
-
-    return b;
+	*pn9 = 0;
 }
 
-static void print_vstate()
+void fec_pn9_apply(fec_pn9_t* pn9, uint8_t* data, uint16_t length)
 {
-//	typedef struct {
-//		uint8_t cost;
-//		uint16_t path;
-//	} VITERBIPATH;
-//	typedef struct {
-//		uint8_t path_size;
-//		VITERBIPATH* old;
-//		VITERBIPATH* new;
-//		VITERBIPATH states1[8];
-//		VITERBIPATH states2[8];
-//	} VITERBISTATE;
-
-	printf("VSTATE:\n");
-	printf(" - path_size: %d\n", vstate.path_size);
-	//printf(" - old: %03d - %s\n", vstate.old->cost, int_to_binary(vstate.old->path));
-	//printf(" - new: %03d - %s\n", vstate.new->cost, int_to_binary(vstate.new->path));
-	int i;
-	for (i=0;i<8;i++)
-		printf(" - states - %d: %03d - %s\n", i, vstate.old[i].cost, int_to_binary(vstate.old[i].path));
+	uint16_t position = *pn9;
 
+	// XOR a 32 bit word at a time, memcpy() allows unaligned data and compiles to plain loads and stores
+	for (; length >= 4; length -= 4, data += 4)
+	{
+		uint32_t word, keystream;
+		memcpy(&word, data, 4);
+		memcpy(&keystream, &pn9_keystream[position], 4);
+		word ^= keystream;
+		memcpy(data, &word, 4);
+
+		position += 4;
+		if (position >= PN9_PERIOD)
+			position -= PN9_PERIOD;
+	}
+
+	for (; length > 0; length--, data++)
+	{
+		*data ^= pn9_keystream[position++];
+		if (position == PN9_PERIOD)
+			position = 0;
+	}
+
+	*pn9 = position;
 }
 
+uint32_t fec_interleave(uint32_t symbols)
+{
+	// transpose the 4x4 matrix of 2 bit symbols, symbol m of byte b is at bit 8b + 2m: first swap the symbols
+	// within each 2x2 block, then swap the off-diagonal 2x2 blocks
+	uint32_t t = (symbols ^ (symbols >> 6)) & 0x00CC00CC;
+	symbols ^= t ^ (t << 6);
+	t = (symbols ^ (symbols >> 12)) & 0x0000F0F0;
+	symbols ^= t ^ (t << 12);
+	return symbols;
+}
 
 uint16_t fec_calculated_decoded_length(uint8_t packet_length)
 {
 	return 2* (packet_length + 2 - (packet_length % 2));
 }
 
+// the 8 symbols sent for a byte, given the byte in the lower 8 bits of bits and the previous byte above it.
+// Only the last 3 bits of the previous byte (the state of the encoder) are used. The symbols of the 4 MSBs are sent
+// first, they are returned in the lower byte
+static inline uint16_t encode_byte(uint16_t bits)
+{
+	return symbol_lut[(bits >> 4) & 0x7F] | (symbol_lut[bits & 0x7F] << 8);
+}
+
+static inline uint8_t get_input_byte(uint8_t* data, uint16_t nbytes, int16_t i)
+{
+	if(i < 0)
+		return 0; // the initial state of the encoder
+
+	return i < nbytes ? data[i] : TRELLIS_TERMINATOR;
+}
+
 /* Convolutional encoder */
 uint16_t fec_encode(uint8_t *data, uint16_t nbytes)
 {
-	memcpy(data_buffer, data, nbytes);
-	uint8_t *input = data_buffer;
-	unsigned int encstate = 0;
-	int i;
-
-	int termintor_bytes = 2 + nbytes%2;
-	//printf("Length %d -> terminator %d\n", nbytes, termintor_bytes);
-	nbytes+=termintor_bytes;
-	uint16_t length = 0;
-	uint8_t fecbuffer[4] = {0,0,0,0};
-
-	int8_t buffer_pointer = 0;
-	while(nbytes-- > 0){
-		if (nbytes < termintor_bytes) *input = TRELLIS_TERMINATOR;
-
-		//printf("%02X:", *input);
-
-		int j = 6;
-		for(i=7;i>=0;i--){
-				encstate = (encstate << 1) | ((*input >> i) & 1);
-				fecbuffer[buffer_pointer] |= fec_lut[encstate & 0x0F] << j;
-				j -=2;
-
-				//printf("%d: %d - %d -> %s\n",j+2, ((*input >> i) & 1), encstate & 0x0F, byte_to_binary(fec_lut[encstate & 0x0F]));
-				if (j < 0)
-				{
-//						//fecbuffer[buffer_pointer] = 0;
-					buffer_pointer++;
-					j = 6;
-//						length++;
-				}
-		}
+	// the data is terminated with 2 or 3 terminator bytes, to get an even number of bytes
+	uint16_t terminated_length = nbytes + 2 + nbytes % 2;
 
-		if (buffer_pointer == 4)
-		{
-#ifdef INTERLEAVING
-			//printf("Non: "); print_array(fecbuffer, 4); printf("\n");
-			//Interleaving and write to output buffer
-			*data++ = ((fecbuffer[0] & 0x03)) |\
-						((fecbuffer[1] & 0x03) << 2) |\
-						((fecbuffer[2] & 0x03) << 4) |\
-						((fecbuffer[3] & 0x03) << 6);
-			*data++ = (((fecbuffer[0] >> 2) & 0x03)) |\
-							(((fecbuffer[1] >> 2) & 0x03) << 2) |\
-							(((fecbuffer[2] >> 2) & 0x03) << 4) |\
-							(((fecbuffer[3] >> 2) & 0x03) << 6);
-			*data++ = (((fecbuffer[0] >> 4) & 0x03)) |\
-							(((fecbuffer[1] >> 4) & 0x03) << 2) |\
-							(((fecbuffer[2] >> 4) & 0x03) << 4) |\
-							(((fecbuffer[3] >> 4) & 0x03) << 6);
-			*data++ = (((fecbuffer[0] >> 6) & 0x03)) |\
-							(((fecbuffer[1] >> 6) & 0x03) << 2) |\
-							(((fecbuffer[2] >> 6) & 0x03) << 4) |\
-							(((fecbuffer[3] >> 6) & 0x03) << 6);
-			//printf("Int: "); print_array(output-4, 4); printf("\n");
-#else
-			*output++ = fecbuffer[0];
-			*output++ = fecbuffer[1];
-			*output++ = fecbuffer[2];
-			*output++ = fecbuffer[3];
+	// the symbols of a byte only depend on that byte and the previous one, so the data is encoded in place
+	// starting from the end, two bytes into four at a time: the bytes which are overwritten are encoded already
+	int16_t i;
+	for(i = terminated_length - 2; i >= 0; i -= 2)
+	{
+		uint8_t previous = get_input_byte(data, nbytes, i - 1);
+		uint8_t byte0 = get_input_byte(data, nbytes, i);
+		uint8_t byte1 = get_input_byte(data, nbytes, i + 1);
+		uint32_t symbols = encode_byte(((uint16_t)previous << 8) | byte0) |
+						   ((uint32_t)encode_byte(((uint16_t)byte0 << 8) | byte1) << 16);
+
+		//Interleaving and write to output buffer
+		symbols = fec_interleave(symbols);
+		uint8_t* output = data + 2 * i;
+		output[0] = symbols;
+		output[1] = symbols >> 8;
+		output[2] = symbols >> 16;
+		output[3] = symbols >> 24;
+	}
 
-#endif
-			buffer_pointer=0;
-			fecbuffer[0] = 0;
-			fecbuffer[1] = 0;
-			fecbuffer[2] = 0;
-			fecbuffer[3] = 0;
-			length+=4;
-		}
+	return terminated_length * 2;
+}
 
+void fec_decoder_init(fec_decoder_t* decoder)
+{
+	decoder->cost[0] = 0;
+	uint8_t i;
+	for (i = 1; i < 8; i++)
+		decoder->cost[i] = UNREACHABLE_STATE_COST;
 
-		//printf("%02X%02X ", *(output-2), *(output-1));
+	decoder->steps = 0;
+	decoder->block_length = 0;
+}
 
-		input++;
+// add-compare-select for one received symbol, given the branch metrics of the butterflies (see branch_metric)
+// and the sum of the metrics of a symbol and its complement
+static void decode_symbol(fec_decoder_t* decoder, const uint8_t* metric, uint8_t complement_metric)
+{
+	uint16_t cost[8];
+	uint8_t decisions = 0;
+	uint8_t p;
+	for (p = 0; p < 4; p++)
+	{
+		uint16_t cost0 = decoder->cost[p];
+		uint16_t cost1 = decoder->cost[p + 4];
+
+		//butterfly operation for 0
+		uint16_t hamming0 = cost0 + metric[p];
+		uint16_t hamming1 = cost1 + complement_metric - metric[p];
+		if (hamming0 <= hamming1)
+			cost[2 * p] = hamming0;
+		else
+		{
+			cost[2 * p] = hamming1;
+			decisions |= 1 << (2 * p);
+		}
 
+		//butterfly operation for 1
+		hamming0 = cost0 + complement_metric - metric[p];
+		hamming1 = cost1 + metric[p];
+		if (hamming0 <= hamming1)
+			cost[2 * p + 1] = hamming0;
+		else
+		{
+			cost[2 * p + 1] = hamming1;
+			decisions |= 1 << (2 * p + 1);
+		}
 	}
 
-
-	//printf("\n");
-	return length;
+	memcpy(decoder->cost, cost, sizeof(cost));
+	decoder->decisions[decoder->steps % FEC_DECODER_TRACEBACK_STEPS] = decisions;
+	decoder->steps++;
 }
 
-uint8_t fec_decode_packet(uint8_t* data, uint8_t packet_length, uint8_t output_length)
+// the state with the lowest cost, the costs are normalized to it
+static uint8_t get_best_state(fec_decoder_t* decoder)
 {
-	uint8_t* output = data_buffer;
-	if(output_length < packet_length)
-	{
-		DPRINT("FEC decoding error: buffer to small\n");
-		return 0;
+	uint8_t min_state = 0;
+	int8_t j;
+	for (j = 7; j != 0; j--) {
+		if(decoder->cost[j] < decoder->cost[min_state])
+			min_state = j;
 	}
 
-	if(packet_length % 4 != 0)
+	uint16_t min_cost = decoder->cost[min_state];
+	for (j = 0; j < 8; j++)
+		decoder->cost[j] -= min_cost;
+
+	return min_state;
+}
+
+// trace back from the state with the lowest cost over the last skip_steps decisions,
+// and return the byte decoded from the 8 decisions before them
+static uint8_t trace_back(fec_decoder_t* decoder, uint8_t skip_steps)
+{
+	uint8_t state = get_best_state(decoder);
+	uint16_t step = decoder->steps;
+	uint8_t byte = 0;
+	uint8_t i;
+	for (i = 0; i < skip_steps + 8; i++)
 	{
-		DPRINT("FEC decoding error: data 32 bit aligned\n");
-		return 0;
+		if (i >= skip_steps)
+			byte |= (state & 0x01) << (i - skip_steps); // the bits are traced back starting from the LSB
+
+		step--;
+		state = (state >> 1) | (((decoder->decisions[step % FEC_DECODER_TRACEBACK_STEPS] >> state) & 0x01) << 2);
 	}
 
-	output_buffer = output;
-	packetlength = packet_length;
-	fecpacketlength = ((packet_length & 0xFE) + 2) << 1;
-	output_packet_length = output_length;
+	return byte;
+}
 
-	processedbytes = 0;
-	fecprocessedbytes = 0;
+// decode a block of 4 encoded bytes into (up to) 2 bytes
+static uint8_t decode_block(fec_decoder_t* decoder, uint8_t* input, uint8_t* output)
+{
+	uint8_t decoded_length = 0;
 
-	vstate.path_size = 0;
+	// the 16 symbols of the 4 bytes are interleaved, after deinterleaving every byte contains the symbols of
+	// a nibble of the 2 decoded bytes, starting from the MSB
+	uint32_t symbols = fec_interleave(input[0] | (input[1] << 8) | ((uint32_t)input[2] << 16) | ((uint32_t)input[3] << 24));
+	int8_t b, m;
+	for (b = 0; b < 4; b++, symbols >>= 8)
+	{
+		for (m = 3; m >= 0; m--)
+			decode_symbol(decoder, branch_metric[(symbols >> (2 * m)) & 0x03], 2);
 
-	vstate.states1[0].cost = 0;
-	int16_t i;
-	for (i=1;i<8;i++)
-			vstate.states1[i].cost = 100;
+		// a byte is decided when the decisions for the next byte are known as well
+		if ((b & 0x01) && decoder->steps >= FEC_DECODER_TRACEBACK_STEPS)
+			output[decoded_length++] = trace_back(decoder, 8);
+	}
 
-	vstate.old = vstate.states1;
-	vstate.new = vstate.states2;
+	return decoded_length;
+}
+
+// the soft decision branch metric of a symbol, given the soft bits of its MSB and LSB
+static inline uint8_t get_soft_metric(uint8_t expected_symbol, uint8_t soft_msb, uint8_t soft_lsb)
+{
+	return ((expected_symbol & 0x02) ? FEC_SOFT_BIT_MAX - soft_msb : soft_msb) +
+		   ((expected_symbol & 0x01) ? FEC_SOFT_BIT_MAX - soft_lsb : soft_lsb);
+}
 
+// decode a block of 4 encoded bytes, given as 32 soft bits, into (up to) 2 bytes
+static uint8_t decode_soft_block(fec_decoder_t* decoder, const uint8_t* soft_bits, uint8_t* output)
+{
 	uint8_t decoded_length = 0;
 
-	for(i = 0; i < packet_length; i =i+4)
+	// same order as decode_block(), the soft bits of a byte start from its MSB
+	int8_t b, m;
+	for (b = 0; b < 4; b++)
 	{
-		//printf("FEC encoding i = %d\n", i);
+		for (m = 3; m >= 0; m--)
+		{
+			uint8_t soft_msb = soft_bits[8 * m + 6 - 2 * b];
+			uint8_t soft_lsb = soft_bits[8 * m + 7 - 2 * b];
+			uint8_t metric[4];
+			uint8_t p;
+			for (p = 0; p < 4; p++)
+				metric[p] = get_soft_metric(fec_lut[2 * p], soft_msb, soft_lsb);
+
+			decode_symbol(decoder, metric, 2 * FEC_SOFT_BIT_MAX);
+		}
 
-		bool err = fec_decode(&data[i]);
-		decoded_length+=2;
-		if (!err)
-			DPRINT("FEC encoding error\n");
+		if ((b & 0x01) && decoder->steps >= FEC_DECODER_TRACEBACK_STEPS)
+			output[decoded_length++] = trace_back(decoder, 8);
 	}
 
-	memcpy(data, data_buffer, decoded_length);
+	return decoded_length;
+}
+
+uint16_t fec_decoder_decode_soft(fec_decoder_t* decoder, const uint8_t* soft_bits, uint16_t length, uint8_t* output)
+{
+	uint16_t decoded_length = 0;
+	for (; length >= 32; length -= 32, soft_bits += 32)
+		decoded_length += decode_soft_block(decoder, soft_bits, output + decoded_length);
 
 	return decoded_length;
 }
 
-static bool fec_decode(uint8_t* input)
+uint16_t fec_decoder_decode(fec_decoder_t* decoder, uint8_t* input, uint16_t length, uint8_t* output)
 {
-	uint8_t i, k;
-	int8_t j;
-	uint8_t min_state;
-	uint8_t symbol;
-	uint16_t tmppn9;
-	uint8_t fecbuffer[4];
-	VITERBIPATH* vstate_tmp;
-
-	if(fecprocessedbytes >= fecpacketlength)
-		return false;
-
-	//Deinterleaving (symbols are stored in reverse as this is easier for Viterbi decoding)
-
-#ifdef INTERLEAVING
-	//printf("Int: "); print_array(input, 4); printf("\n");
-	fecbuffer[0] = ((input[0] & 0x03)) |\
-					((input[1] & 0x03) << 2) |\
-					((input[2] & 0x03) << 4) |\
-					((input[3] & 0x03) << 6);
-	fecbuffer[1] = (((input[0] >> 2) & 0x03)) |\
-					(((input[1] >> 2) & 0x03) << 2) |\
-					(((input[2] >> 2) & 0x03) << 4) |\
-					(((input[3] >> 2) & 0x03) << 6);
-	fecbuffer[2] = (((input[0] >> 4) & 0x03)) |\
-					(((input[1] >> 4) & 0x03) << 2) |\
-					(((input[2] >> 4) & 0x03) << 4) |\
-					(((input[3] >> 4) & 0x03) << 6);
-	fecbuffer[3] = (((input[0] >> 6) & 0x03)) |\
-					(((input[1] >> 6) & 0x03) << 2) |\
-					(((input[2] >> 6) & 0x03) << 4) |\
-					(((input[3] >> 6) & 0x03) << 6);
-	//printf("DeI: "); print_array(fecbuffer, 4); printf("\n");
-#else
-	fecbuffer[0] = input[0];
-	fecbuffer[1] = input[1];
-	fecbuffer[2] = input[2];
-	fecbuffer[3] = input[3];
-#endif
-	//printf(" input = %04X%04X\n", fecbuffer[0],fecbuffer[1]);
-	fecprocessedbytes +=4;
-
-	for (i = 0; i < 3; i=i+2) {
-		//Viterbi decoding
-		//printf(" Encode i  %d -> %04X %s\n", i, fecbuffer[i], int_to_binary(fecbuffer[i]));
-
-		// todo: fix for loop
-		for (j = 7; j >= 0; j--) {
-			if (j>3)
-				symbol = (fecbuffer[i] >> (j-4)*2) & 0x03;
-			else
-				symbol = (fecbuffer[i+1] >> j*2) & 0x03;
-			//printf(" Symbol %d %x - %s\n", j, symbol, int_to_binary(symbol));
-			//fecbuffer[i] >>= 2;
-
-			for(k = 0; k < 8; k++) {
-				uint8_t cost0, cost1;
-				uint8_t state0, state1;
-				uint8_t hamming0, hamming1;
-
-				state0 = k >> 1;
-				state1 = state0 + 4;
-
-				cost0  = vstate.old[state0].cost;
-				cost1  = vstate.old[state1].cost;
-
-				//butterfly operation for 0
-				hamming0 = cost0 + (((trellis0_lut[state0] ^ symbol) + 1) >> 1);
-				hamming1 = cost1 + (((trellis0_lut[state1] ^ symbol) + 1) >> 1);
-
-				if(hamming0 <= hamming1) {
-					vstate.new[k].cost = hamming0;
-					vstate.new[k].path = vstate.old[state0].path << 1;
-				} else {
-					vstate.new[k].cost = hamming1;
-					vstate.new[k].path = vstate.old[state1].path << 1;
-				}
-
-				//printf("k %d part 1\n");
-				//print_vstate();
-
-				k++;
-
-				//butterfly operation for 1
-				hamming0 = cost0 + (((trellis1_lut[state0] ^ symbol) + 1) >> 1);
-				hamming1 = cost1 + (((trellis1_lut[state1] ^ symbol) + 1) >> 1);
-
-				if(hamming0 <= hamming1) {
-					vstate.new[k].cost = hamming0;
-					vstate.new[k].path = vstate.old[state0].path << 1 | 0x01;
-				} else {
-					vstate.new[k].cost = hamming1;
-					vstate.new[k].path = vstate.old[state1].path << 1 | 0x01;
-				}
-
-				//printf("k %d part 2\n");
-				//print_vstate();
-			}
-
-			//Swap Viterbi paths
-			vstate_tmp = vstate.new;
-			vstate.new = vstate.old;
-			vstate.old = vstate_tmp;
-
-			//print_vstate();
+	uint16_t decoded_length = 0;
+
+	// complete the block left over from the previous chunk first
+	if (decoder->block_length > 0)
+	{
+		while (decoder->block_length < 4 && length > 0)
+		{
+			decoder->block[decoder->block_length++] = *input++;
+			length--;
 		}
 
-		vstate.path_size++;
+		if (decoder->block_length < 4)
+			return 0;
 
-		//Flush out byte if path is full
-		if ((vstate.path_size == 2) && (processedbytes < packetlength)) {
-			//Calculate path with lowest cost
-			min_state = 0;
-			for (j = 7; j != 0; j--) {
-				if(vstate.old[j].cost < vstate.old[min_state].cost)
-					min_state = j;
-			}
+		decoded_length += decode_block(decoder, decoder->block, output);
+		decoder->block_length = 0;
+	}
 
-	        //Normalize costs
-			if (vstate.old[min_state].cost > 0)
-				for (j = 0; j < 8; j++) vstate.old[j].cost -= vstate.old[min_state].cost;
+	for (; length >= 4; length -= 4, input += 4)
+		decoded_length += decode_block(decoder, input, output + decoded_length);
 
-			*output_buffer++ = vstate.old[min_state].path >> 8;
-			vstate.path_size--;
+	// keep the remaining bytes until the next chunk
+	while (length > 0)
+	{
+		decoder->block[decoder->block_length++] = *input++;
+		length--;
+	}
 
-			processedbytes++;
+	return decoded_length;
+}
 
-			if (processedbytes+ 2 == packetlength)
-				*output_buffer = (uint8_t) (vstate.old[min_state].path);
-		}
+uint16_t fec_decoder_finish(fec_decoder_t* decoder, uint8_t* output)
+{
+	if (decoder->steps < 8)
+		return 0;
+
+	output[0] = trace_back(decoder, 0);
+	return 1;
+}
+
+uint16_t fec_rx_start(fec_rx_t* rx, uint8_t* header)
+{
+	fec_decoder_init(&rx->decoder);
+	rx->output_length = fec_decoder_decode(&rx->decoder, header, FEC_RX_HEADER_LENGTH, header);
+	rx->input_length = FEC_RX_HEADER_LENGTH;
+	rx->packet_length = fec_calculated_decoded_length(header[0] + 1);
+	return rx->packet_length;
+}
+
+void fec_rx_decode(fec_rx_t* rx, uint8_t* data, uint16_t received_length)
+{
+	if (received_length > rx->packet_length)
+		received_length = rx->packet_length;
+
+	if (received_length <= rx->input_length)
+		return;
+
+	rx->output_length += fec_decoder_decode(&rx->decoder, data + rx->input_length, received_length - rx->input_length,
+											data + rx->output_length);
+	rx->input_length = received_length;
+}
+
+uint16_t fec_rx_finish(fec_rx_t* rx, uint8_t* data)
+{
+	rx->output_length += fec_decoder_finish(&rx->decoder, data + rx->output_length);
+	return rx->output_length;
+}
+
+uint16_t fec_decode_packet(uint8_t* data, uint16_t packet_length, uint16_t output_length)
+{
+	if(output_length < packet_length)
+	{
+		DPRINT("FEC decoding error: buffer to small\n");
+		return 0;
 	}
 
-	//print_vstate();
+	if(packet_length % 4 != 0)
+	{
+		DPRINT("FEC decoding error: data 32 bit aligned\n");
+		return 0;
+	}
 
+	// the decoded bytes are written behind the encoded bytes which are being read, so the data is decoded in place
+	fec_decoder_t decoder;
+	fec_decoder_init(&decoder);
+	uint16_t decoded_length = fec_decoder_decode(&decoder, data, packet_length, data);
+	decoded_length += fec_decoder_finish(&decoder, data + decoded_length);
+	return decoded_length;
+}
 
+uint16_t fec_decode_packet_soft(const uint8_t* soft_bits, uint16_t packet_length, uint8_t* output)
+{
+	if(packet_length % 4 != 0)
+	{
+		DPRINT("FEC decoding error: data 32 bit aligned\n");
+		return 0;
+	}
 
-	return true;
+	fec_decoder_t decoder;
+	fec_decoder_init(&decoder);
+	uint16_t decoded_length = fec_decoder_decode_soft(&decoder, soft_bits, packet_length * 8, output);
+	decoded_length += fec_decoder_finish(&decoder, output + decoded_length);
+	return decoded_length;
 }
 
 //#endif /* D7_PHY_USE_FEC */
@@ -37,27 +37,70 @@ void fifo_init_filled(fifo_t *fifo, uint8_t *buffer, uint16_t filled_size, uint1
     fifo->tail_idx = filled_size;
 }
 
+// the number of bytes which can be written contiguously at the tail. When the data wraps, the tail stays at least
+// one byte before the head, since head_idx == tail_idx means the FIFO is empty
+static uint16_t get_contiguous_free_space(fifo_t* fifo)
+{
+    if(fifo->tail_idx < fifo->head_idx)
+        return fifo->head_idx - fifo->tail_idx - 1;
+
+    if(fifo->tail_idx < fifo->max_size)
+        return fifo->max_size - fifo->tail_idx;
+
+    // the tail is at the end of the buffer, continue at the start
+    return fifo->head_idx > 0 ? fifo->head_idx - 1 : 0;
+}
+
 error_t fifo_put(fifo_t *fifo, uint8_t *data, uint16_t len)
 {
-    if(fifo->tail_idx + len <= fifo->max_size)
-    {
-        memcpy(fifo->buffer + fifo->tail_idx, data, len);
-        fifo->tail_idx += len;
-        return SUCCESS;
-    }
+    if(len > fifo_get_free_space(fifo))
+        return ESIZE;
 
-    uint16_t space_left_before_max_size = fifo->max_size - fifo->tail_idx;
-    uint16_t space_needed_after_wrap = len - space_left_before_max_size;
-    if(fifo->head_idx > space_needed_after_wrap)
+    // at most two pieces: up to the end of the buffer and after wrapping
+    while(len > 0)
     {
-        // wrap
-        memcpy(fifo->buffer + fifo->tail_idx, data, space_left_before_max_size);
-        memcpy(fifo->buffer, data + space_left_before_max_size, space_needed_after_wrap);
-        fifo->tail_idx = space_needed_after_wrap;
-        return SUCCESS;
+        uint8_t* region;
+        uint16_t region_len = fifo_reserve(fifo, &region);
+        if(region_len > len)
+            region_len = len;
+
+        memcpy(region, data, region_len);
+        fifo_commit(fifo, region_len);
+        data += region_len;
+        len -= region_len;
     }
+
+    return SUCCESS;
+}
+
+uint16_t fifo_reserve(fifo_t* fifo, uint8_t** data)
+{
+    // an empty FIFO can start again at the beginning of the buffer, to get the largest contiguous region
+    if(fifo->head_idx == fifo->tail_idx)
+        fifo_clear(fifo);
+
+    if(fifo->tail_idx == fifo->max_size)
+        *data = fifo->buffer;
     else
+        *data = fifo->buffer + fifo->tail_idx;
+
+    return get_contiguous_free_space(fifo);
+}
+
+error_t fifo_commit(fifo_t* fifo, uint16_t len)
+{
+    if(len > get_contiguous_free_space(fifo))
         return ESIZE;
+
+    if(len == 0)
+        return SUCCESS;
+
+    if(fifo->tail_idx == fifo->max_size)
+        fifo->tail_idx = len;
+    else
+        fifo->tail_idx += len;
+
+    return SUCCESS;
 }
 
 error_t fifo_put_byte(fifo_t* fifo, uint8_t byte)
@@ -102,6 +145,28 @@ error_t fifo_pop(fifo_t* fifo, uint8_t* buffer, uint16_t len) {
   error_t err = fifo_peek(fifo, buffer, 0, len);
   if( err != SUCCESS ) { return err; }
 
+  return fifo_skip(fifo, len);
+}
+
+uint16_t fifo_peek_contiguous(fifo_t* fifo, uint8_t** data) {
+  if(fifo->head_idx <= fifo->tail_idx) {
+    *data = fifo->buffer + fifo->head_idx;
+    return fifo->tail_idx - fifo->head_idx;
+  }
+
+  // the data wraps, read up to the end of the buffer first
+  if(fifo->head_idx < fifo->max_size) {
+    *data = fifo->buffer + fifo->head_idx;
+    return fifo->max_size - fifo->head_idx;
+  }
+
+  *data = fifo->buffer;
+  return fifo->tail_idx;
+}
+
+error_t fifo_skip(fifo_t* fifo, uint16_t len) {
+  if(len > fifo_get_size(fifo)) { return ESIZE; }
+
   // progress head to implement popping behaviour
   fifo->head_idx = (fifo->head_idx + len);
   if(fifo->head_idx > fifo->max_size)
@@ -118,6 +183,17 @@ uint16_t fifo_get_size(fifo_t* fifo)
         return fifo->tail_idx + (fifo->max_size - fifo->head_idx);
 }
 
+uint16_t fifo_get_free_space(fifo_t* fifo)
+{
+    if(fifo->head_idx == fifo->tail_idx)
+        return fifo->max_size;
+
+    if(fifo->tail_idx < fifo->head_idx)
+        return fifo->head_idx - fifo->tail_idx - 1;
+
+    return (fifo->max_size - fifo->tail_idx) + (fifo->head_idx > 0 ? fifo->head_idx - 1 : 0);
+}
+
 void fifo_clear(fifo_t* fifo)
 {
     fifo->head_idx = 0;
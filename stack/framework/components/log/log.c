@@ -43,7 +43,9 @@ typedef enum {
     LOG_TYPE_DATA = 0x02,
     LOG_TYPE_STACK = 0x03,
     LOG_TYPE_PHY_PACKET_TX = 0X04,
-    LOG_TYPE_PHY_PACKET_RX = 0X05
+    LOG_TYPE_PHY_PACKET_RX = 0X05,
+    LOG_TYPE_TASK_STATS = 0x06,
+    LOG_TYPE_TIMER_STATS = 0x07
 } log_type_t;
 
 static const uint16_t microsec_byte = 2*8000000/CONSOLE_BAUDRATE;
@@ -153,4 +155,54 @@ __LINK_C void log_print_raw_phy_packet(hw_radio_packet_t* packet, bool is_tx)
     hw_busy_wait(microsec_byte);
 }
 
+#ifdef FRAMEWORK_SCHEDULER_INSTRUMENTATION
+__LINK_C void log_print_task_stats(task_handle_t handle, sched_task_stats_t* stats)
+{
+#ifdef FRAMEWORK_LOG_BINARY
+    console_print_byte(0xDD);
+    console_print_byte(LOG_TYPE_TASK_STATS);
+    console_print_byte(handle);
+    console_print_bytes((uint8_t*)&(stats->runs), sizeof(uint32_t));
+    console_print_bytes((uint8_t*)&(stats->total_exec_time), sizeof(uint32_t));
+    console_print_bytes((uint8_t*)&(stats->max_exec_time), sizeof(uint32_t));
+    console_print_bytes((uint8_t*)&(stats->total_latency), sizeof(uint32_t));
+    console_print_bytes((uint8_t*)&(stats->max_latency), sizeof(uint32_t));
+#else
+    printf("\n\r[%03d] task %d: runs %lu exec total %lu max %lu latency total %lu max %lu", NG(counter)++, handle,
+           (unsigned long)stats->runs, (unsigned long)stats->total_exec_time, (unsigned long)stats->max_exec_time,
+           (unsigned long)stats->total_latency, (unsigned long)stats->max_latency);
+#endif //FRAMEWORK_LOG_BINARY
+    hw_busy_wait(microsec_byte);
+}
+#endif //FRAMEWORK_SCHEDULER_INSTRUMENTATION
+
+#ifdef FRAMEWORK_TIMER_INSTRUMENTATION
+static void print_latency_stats(char* name, timer_latency_stats_t* stats)
+{
+#ifdef FRAMEWORK_LOG_BINARY
+    console_print_bytes((uint8_t*)&(stats->count), sizeof(uint32_t));
+    console_print_bytes((uint8_t*)&(stats->min), sizeof(timer_tick_t));
+    console_print_bytes((uint8_t*)&(stats->max), sizeof(timer_tick_t));
+    console_print_bytes((uint8_t*)stats->histogram, sizeof(stats->histogram));
+#else
+    printf("\n\r[%03d] timer %s latency: count %lu min %lu max %lu histogram", NG(counter)++, name,
+           (unsigned long)stats->count, (unsigned long)(stats->count ? stats->min : 0), (unsigned long)stats->max);
+    for(uint8_t i = 0; i < TIMER_STATS_HISTOGRAM_SIZE; i++)
+        printf(" %lu", (unsigned long)stats->histogram[i]);
+#endif //FRAMEWORK_LOG_BINARY
+}
+
+__LINK_C void log_print_timer_stats(timer_stats_t* stats)
+{
+#ifdef FRAMEWORK_LOG_BINARY
+    console_print_byte(0xDD);
+    console_print_byte(LOG_TYPE_TIMER_STATS);
+    console_print_byte(TIMER_STATS_HISTOGRAM_SIZE);
+#endif //FRAMEWORK_LOG_BINARY
+    print_latency_stats("fire", &(stats->fire_latency));
+    print_latency_stats("dispatch", &(stats->dispatch_latency));
+    hw_busy_wait(microsec_byte);
+}
+#endif //FRAMEWORK_TIMER_INSTRUMENTATION
+
 #endif //FRAMEWORK_LOG_ENABLED
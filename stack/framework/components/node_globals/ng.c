@@ -18,10 +18,40 @@
 
 #include "ng.h"
 #if defined(NODE_GLOBALS)
-size_t __ng_node_id__ = 0xFFFFFFFF;
+__NG_THREAD_LOCAL__ size_t __ng_node_id__ = 0xFFFFFFFF;
+
+#if defined(NODE_GLOBALS_CONTEXT)
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#define CONTEXT_ALIGNMENT 64 // a cache line, contexts used by different threads do not share one
+
+extern char __stop_ng_context[];
+__NG_THREAD_LOCAL__ char* __ng_context__;
+static char* contexts[__ng_max_nodes__];
+
+static char* create_context()
+{
+    // the context is a copy of the template, so NGDEF variables keep their initial values
+    size_t size = __stop_ng_context - __start_ng_context;
+    char* block = malloc(size + CONTEXT_ALIGNMENT);
+    assert(block != NULL);
+    char* context = (char*)(((uintptr_t)block + CONTEXT_ALIGNMENT - 1) & ~(uintptr_t)(CONTEXT_ALIGNMENT - 1));
+    memcpy(context, __start_ng_context, size);
+    return context;
+}
+#endif
+
 __LINK_C void set_node_global_id(size_t node_id)
 {
 	assert(node_id < __ng_max_nodes__);
     __ng_node_id__ = node_id;
+#if defined(NODE_GLOBALS_CONTEXT)
+    if(contexts[node_id] == NULL)
+        contexts[node_id] = create_context();
+
+    __ng_context__ = contexts[node_id];
+#endif
 }
 #endif
@@ -0,0 +1,129 @@
+/* * OSS-7 - An opensource implementation of the DASH7 Alliance Protocol for ultra
+ * lowpower wireless sensor communication
+ *
+ * Copyright 2015 University of Antwerp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "pt.h"
+
+#include "hwatomic.h"
+#include "debug.h"
+
+static void timer_expired(void* arg);
+
+static void run_thread(void* arg)
+{
+    pt_t* pt = (pt_t*)arg;
+    //cleared before running, so the thread is resumed again when signalled while running
+    pt->scheduled = false;
+    if(pt->thread == 0x0)
+        return; // stopped while scheduled
+
+    if(pt->thread(pt) >= PT_EXITED)
+    {
+        timer_cancel_event(&timer_expired, pt);
+        pt->thread = 0x0;
+    }
+}
+
+static void timer_expired(void* arg)
+{
+    pt_t* pt = (pt_t*)arg;
+    pt->timer_expired = true;
+    run_thread(pt);
+}
+
+__LINK_C error_t pt_start(pt_t* pt, pt_thread_t thread, uint8_t priority)
+{
+    if(priority > MIN_PRIORITY || priority < MAX_PRIORITY)
+        return ESIZE;
+    if(pt_is_running(pt))
+        return EALREADY;
+
+    pt->lc = 0;
+    pt->priority = priority;
+    pt->scheduled = false;
+    pt->signalled = false;
+    pt->timer_expired = false;
+    pt->timer_set = false;
+    pt->thread = thread;
+    pt_resume(pt);
+    return SUCCESS;
+}
+
+__LINK_C void pt_stop(pt_t* pt)
+{
+    timer_cancel_event(&timer_expired, pt);
+    timer_cancel_event(&run_thread, pt);
+    // an already posted event returns immediately
+    pt->thread = 0x0;
+}
+
+__LINK_C void pt_resume(pt_t* pt)
+{
+    start_atomic();
+    bool post = pt_is_running(pt) && !pt->scheduled;
+    pt->scheduled = true;
+    end_atomic();
+
+    if(!post)
+        return;
+
+    //when the scheduler is out of event records, let the timer post the event as soon as a record is free.
+    //When it is out of timers as well the resume is lost, a later pt_resume() or pt_signal() tries again
+    if(sched_post_event_prio(&run_thread, pt, pt->priority) != SUCCESS
+       && timer_post_event_prio(&run_thread, pt, timer_get_counter_value(), pt->priority) != SUCCESS)
+        pt->scheduled = false;
+}
+
+__LINK_C void pt_signal(pt_t* pt)
+{
+    pt->signalled = true;
+    pt_resume(pt);
+}
+
+__LINK_C bool pt_take_signal(pt_t* pt)
+{
+    start_atomic();
+    bool signalled = pt->signalled;
+    pt->signalled = false;
+    end_atomic();
+    return signalled;
+}
+
+__LINK_C void pt_set_timer(pt_t* pt, timer_tick_t time)
+{
+    pt->timer_expired = false;
+    pt->timer_set = false;
+    pt->timer_time = time;
+}
+
+__LINK_C bool pt_is_timer_expired(pt_t* pt)
+{
+    if(!pt->timer_set)
+    {
+        //out of timers (FRAMEWORK_TIMER_STACK_SIZE): the thread polls until one is free
+        if(timer_post_event_prio(&timer_expired, pt, pt->timer_time, pt->priority) != SUCCESS)
+        {
+            pt_resume(pt);
+            return false;
+        }
+
+        pt->timer_set = true;
+    }
+
+    return pt->timer_expired;
+}
@@ -18,8 +18,30 @@
 
 #include "random.h"
 #include "types.h"
+#include "ng.h"
 #include <stdlib.h>
 
+#if defined(NODE_GLOBALS)
+// the nodes share the process (and possibly run on different threads): every node gets a
+// generator of its own, so its sequence does not depend on what the other nodes draw
+static uint32_t NGDEF(_rng_state);
+#define rng_state NG(_rng_state)
+
+__LINK_C uint32_t get_rnd()
+{
+    // xorshift32, limited to the range of rand()
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state >> 1;
+}
+
+__LINK_C void set_rng_seed(unsigned int seed)
+{
+    // xorshift does not work with an all zero state
+    rng_state = seed ? seed : 1;
+}
+#else
 __LINK_C uint32_t get_rnd()
 {
     return (uint32_t) rand();
@@ -29,3 +51,4 @@ __LINK_C void set_rng_seed(unsigned int seed)
 {
     srand(seed);
 }
+#endif
@@ -33,20 +33,22 @@
 #include "hwatomic.h"
 #include "ng.h"
 #include "hwsystem.h"
+#include "timer.h"
+#include "log.h"
 
 #include "framework_defs.h"
 #define SCHEDULER_MAX_TASKS FRAMEWORK_SCHEDULER_MAX_TASKS
-
-#ifdef NODE_GLOBALS
-    #warning NODE_GLOBALS is defined when using the default scheduler. Are you sure this is what you want ?
-#endif
+#define SCHEDULER_MAX_EVENTS FRAMEWORK_SCHEDULER_MAX_EVENTS
 
 enum
 {
 	NUM_PRIORITIES = MIN_PRIORITY+1,
 	NUM_TASKS = SCHEDULER_MAX_TASKS,
 	NOT_SCHEDULED = NUM_PRIORITIES,
+	DEADLINE_SCHEDULED = NUM_PRIORITIES+1,
 	NO_TASK = SCHEDULER_MAX_TASKS,
+	NUM_EVENTS = SCHEDULER_MAX_EVENTS,
+	NO_EVENT = SCHEDULER_MAX_EVENTS,
 };
 
 typedef struct
@@ -65,13 +67,70 @@ typedef struct
 	uint8_t index;
 } taskindex_info_t;
 
+typedef struct
+{
+	event_handler_t handler;
+	void* arg;
+	uint8_t next;
+
+} event_info_t;
+
 taskindex_info_t NGDEF(m_index)[NUM_TASKS];
 task_info_t NGDEF(m_info)[NUM_TASKS];
 
 uint8_t NGDEF(m_head)[NUM_PRIORITIES];
 uint8_t NGDEF(m_tail)[NUM_PRIORITIES];
-volatile uint8_t NGDEF(current_priority);
+//a bit per priority which has tasks waiting, the highest priority (MAX_PRIORITY) in the most significant bit
+//so the next priority to run is found with a single count leading zeros
+volatile unsigned int NGDEF(m_ready);
 unsigned int NGDEF(num_registered_tasks);
+
+//the pool of event records: pending events are kept in a FIFO per priority, the others in a free list
+event_info_t NGDEF(m_events)[NUM_EVENTS];
+uint8_t NGDEF(m_event_head)[NUM_PRIORITIES];
+uint8_t NGDEF(m_event_tail)[NUM_PRIORITIES];
+uint8_t NGDEF(m_free_event);
+volatile unsigned int NGDEF(m_events_ready);
+
+//tasks posted with a deadline are kept in a single list, sorted earliest deadline first, using the
+//next and prev fields of m_info. They are executed before all tasks and events in the priority queues
+volatile uint8_t NGDEF(m_deadline_head);
+timer_tick_t NGDEF(m_deadline)[NUM_TASKS];
+uint32_t NGDEF(m_missed_deadlines);
+
+//compares deadlines relative to each other, to handle timer overflows
+static inline bool deadline_before(timer_tick_t a, timer_tick_t b) { return ((int32_t)(a - b)) < 0; }
+
+#ifdef FRAMEWORK_SCHEDULER_INSTRUMENTATION
+sched_task_stats_t NGDEF(m_stats)[NUM_TASKS];
+timer_tick_t NGDEF(m_post_time)[NUM_TASKS];
+
+//timer_get_counter_value() starts an atomic section itself, so timestamps are taken outside of ours
+static inline timer_tick_t get_timestamp() { return timer_get_counter_value(); }
+
+//must be called with interrupts disabled
+static inline void record_post(uint8_t id, timer_tick_t now) { NG(m_post_time)[id] = now; }
+
+static void record_run(uint8_t id, timer_tick_t start, timer_tick_t end)
+{
+	timer_tick_t latency = start - NG(m_post_time)[id];
+	timer_tick_t exec_time = end - start;
+	NG(m_stats)[id].runs++;
+	NG(m_stats)[id].total_latency += latency;
+	if(latency > NG(m_stats)[id].max_latency)
+		NG(m_stats)[id].max_latency = latency;
+
+	NG(m_stats)[id].total_exec_time += exec_time;
+	if(exec_time > NG(m_stats)[id].max_exec_time)
+		NG(m_stats)[id].max_exec_time = exec_time;
+}
+#else
+static inline timer_tick_t get_timestamp() { return 0; }
+static inline void record_post(uint8_t id, timer_tick_t now) {}
+static inline void record_run(uint8_t id, timer_tick_t start, timer_tick_t end) {}
+#endif
+
+#define READY_BIT(priority) (1u << (sizeof(unsigned int) * 8 - 1 - (priority)))
 #ifdef SCHEDULER_DEBUG
 void check_structs_are_valid()
 {
@@ -119,14 +178,44 @@ void check_structs_are_valid()
 		}
 		assert(NG(m_tail)[prio] == prev_ind);
 	}
+	uint8_t prev_deadline_ind = NO_TASK;
+	for(uint8_t cur_ind = NG(m_deadline_head); cur_ind != NO_TASK; cur_ind = NG(m_info)[cur_ind].next)
+	{
+		assert(cur_ind < NUM_TASKS);
+		assert(!visited[cur_ind]);
+		visited[cur_ind] = true;
+		assert(NG(m_info)[cur_ind].prev == prev_deadline_ind);
+		assert(NG(m_info)[cur_ind].priority == DEADLINE_SCHEDULED);
+		if(prev_deadline_ind != NO_TASK)
+			assert(!deadline_before(NG(m_deadline)[cur_ind], NG(m_deadline)[prev_deadline_ind]));
+
+		prev_deadline_ind = cur_ind;
+	}
 	for(int i = 0; i < NUM_TASKS; i++)
 	{
 		assert((visited[i]) || NG(m_info)[i].priority == NOT_SCHEDULED);
 	}
 
-	assert(NG(current_priority) <= NUM_PRIORITIES);
-	for(int i = 0; i < NG(current_priority); i++)
-		assert(NG(m_head)[i] == NO_TASK);
+	for(int prio = 0; prio < NUM_PRIORITIES; prio++)
+		assert(((NG(m_ready) & READY_BIT(prio)) != 0) == (NG(m_head)[prio] != NO_TASK));
+	assert((NG(m_ready) & (READY_BIT(MIN_PRIORITY) - 1)) == 0);
+
+	unsigned int num_events = 0;
+	for(uint8_t cur_ind = NG(m_free_event); cur_ind != NO_EVENT; cur_ind = NG(m_events)[cur_ind].next)
+		num_events++;
+	for(int prio = 0; prio < NUM_PRIORITIES; prio++)
+	{
+		assert(((NG(m_events_ready) & READY_BIT(prio)) != 0) == (NG(m_event_head)[prio] != NO_EVENT));
+		uint8_t prev_ind = NO_EVENT;
+		for(uint8_t cur_ind = NG(m_event_head)[prio]; cur_ind != NO_EVENT; cur_ind = NG(m_events)[cur_ind].next)
+		{
+			assert(NG(m_events)[cur_ind].handler != 0x0);
+			prev_ind = cur_ind;
+			num_events++;
+		}
+		assert(NG(m_event_tail)[prio] == prev_ind);
+	}
+	assert(num_events == NUM_EVENTS);
 	//INT_Enable();
 	end_atomic();
 }
@@ -147,8 +236,23 @@ __LINK_C void scheduler_init()
 	}
 	memset(NG(m_head), NO_TASK, sizeof(NG(m_head)));
 	memset(NG(m_tail), NO_TASK, sizeof(NG(m_tail)));
-	NG(current_priority) = NUM_PRIORITIES;
+	NG(m_ready) = 0;
+	NG(m_deadline_head) = NO_TASK;
+	NG(m_missed_deadlines) = 0;
 	NG(num_registered_tasks) = 0;
+
+	for(unsigned int i = 0; i < NUM_EVENTS; i++)
+	{
+		NG(m_events)[i].handler = 0x0;
+		NG(m_events)[i].next = (i + 1 < NUM_EVENTS) ? i + 1 : NO_EVENT;
+	}
+	NG(m_free_event) = 0;
+	memset(NG(m_event_head), NO_EVENT, sizeof(NG(m_event_head)));
+	memset(NG(m_event_tail), NO_EVENT, sizeof(NG(m_event_tail)));
+	NG(m_events_ready) = 0;
+#ifdef FRAMEWORK_SCHEDULER_INSTRUMENTATION
+	memset(NG(m_stats), 0, sizeof(NG(m_stats)));
+#endif
 	check_structs_are_valid();
 }
 
@@ -177,11 +281,11 @@ __LINK_C uint8_t get_task_id(task_t task)
 	return NO_TASK;
 }
 
-__LINK_C error_t sched_register_task(task_t task)
+__LINK_C task_handle_t sched_register_task(task_t task)
 {
     assert(NG(num_registered_tasks) <= NUM_TASKS);
     assert(get_task_id(task) == NO_TASK);
-	error_t retVal;
+	task_handle_t handle;
 	check_structs_are_valid();
 	//INT_Disable();
 	start_atomic();
@@ -200,13 +304,14 @@ __LINK_C error_t sched_register_task(task_t task)
             NG(m_index)[i] = NG(m_index)[i-1];
         }
     }
+    //the task id is its index in m_info, which never changes once registered
+    handle = NG(num_registered_tasks);
     NG(num_registered_tasks)++;
-    retVal = SUCCESS;
 
 	//INT_Enable();
 	end_atomic();
 	check_structs_are_valid();
-	return retVal;
+	return handle;
 }
 
 static inline bool is_scheduled(uint8_t id)
@@ -229,104 +334,286 @@ __LINK_C bool sched_is_scheduled(task_t task)
 	return retVal;
 }
 
-__LINK_C error_t sched_post_task_prio(task_t task, uint8_t priority)
+//must be called with interrupts disabled, now is the time of posting (only used for the instrumentation)
+static error_t post_task(uint8_t id, uint8_t priority, timer_tick_t now)
 {
-	error_t retVal;
-	start_atomic();
 	check_structs_are_valid();
-	uint8_t task_id = get_task_id(task);
-	if(task_id == NO_TASK)
-		retVal = EINVAL;
-	else if(priority > MIN_PRIORITY || priority < MAX_PRIORITY)
-		retVal = ESIZE;
-	else if (is_scheduled(task_id))
-		retVal = EALREADY;
+	if(id >= NG(num_registered_tasks))
+		return EINVAL;
+	if(priority > MIN_PRIORITY || priority < MAX_PRIORITY)
+		return ESIZE;
+	if (is_scheduled(id))
+		return EALREADY;
+
+	if(NG(m_head)[priority] == NO_TASK)
+	{
+		NG(m_head)[priority] = id;
+		NG(m_tail)[priority] = id;
+		NG(m_ready) |= READY_BIT(priority);
+	}
 	else
 	{
-		if(NG(m_head)[priority] == NO_TASK)
-		{
-			NG(m_head)[priority] = task_id;
-			NG(m_tail)[priority] = task_id;
-		}
-		else
-		{
-			NG(m_info)[NG(m_tail)[priority]].next = task_id;
-			NG(m_info)[task_id].prev = NG(m_tail)[priority];
-			NG(m_tail)[priority] = task_id;
-		}
-		NG(m_info)[task_id].priority = priority;
-		//if our priority is higher than the currently known maximum priority
-		if((priority < NG(current_priority)))
-			NG(current_priority) = priority;
-		check_structs_are_valid();
-		retVal = SUCCESS;
+		NG(m_info)[NG(m_tail)[priority]].next = id;
+		NG(m_info)[id].prev = NG(m_tail)[priority];
+		NG(m_tail)[priority] = id;
 	}
-	end_atomic();
+	NG(m_info)[id].priority = priority;
+	record_post(id, now);
 	check_structs_are_valid();
-	return retVal;
+	return SUCCESS;
 }
 
-__LINK_C error_t sched_cancel_task(task_t task)
+//must be called with interrupts disabled, now is the time of posting (only used for the instrumentation)
+static error_t post_deadline_task(uint8_t id, timer_tick_t deadline, timer_tick_t now)
 {
 	check_structs_are_valid();
-	error_t retVal;
+	if(id >= NG(num_registered_tasks))
+		return EINVAL;
+	if (is_scheduled(id))
+		return EALREADY;
+
+	//insert before the first task with a later deadline, tasks with the same deadline are executed in FIFO order
+	uint8_t prev = NO_TASK;
+	uint8_t next = NG(m_deadline_head);
+	while(next != NO_TASK && !deadline_before(deadline, NG(m_deadline)[next]))
+	{
+		prev = next;
+		next = NG(m_info)[next].next;
+	}
 
-	start_atomic();
-	uint8_t id = get_task_id(task);
-	if(id == NO_TASK)
-		retVal = EINVAL;
-	else if(!is_scheduled(id))
-		retVal = EALREADY;
+	NG(m_info)[id].prev = prev;
+	NG(m_info)[id].next = next;
+	if(prev == NO_TASK)
+		NG(m_deadline_head) = id;
+	else
+		NG(m_info)[prev].next = id;
+
+	if(next != NO_TASK)
+		NG(m_info)[next].prev = id;
+
+	NG(m_deadline)[id] = deadline;
+	NG(m_info)[id].priority = DEADLINE_SCHEDULED;
+	record_post(id, now);
+	check_structs_are_valid();
+	return SUCCESS;
+}
+
+//must be called with interrupts disabled
+static error_t cancel_task(uint8_t id)
+{
+	check_structs_are_valid();
+	if(id >= NG(num_registered_tasks))
+		return EINVAL;
+	if(!is_scheduled(id))
+		return EALREADY;
+
+	uint8_t priority = NG(m_info)[id].priority;
+	if(priority == DEADLINE_SCHEDULED)
+	{
+		if (NG(m_info)[id].prev == NO_TASK)
+			NG(m_deadline_head) = NG(m_info)[id].next;
+		else
+			NG(m_info)[NG(m_info)[id].prev].next = NG(m_info)[id].next;
+
+		if (NG(m_info)[id].next != NO_TASK)
+			NG(m_info)[NG(m_info)[id].next].prev = NG(m_info)[id].prev;
+	}
 	else
 	{
 		if (NG(m_info)[id].prev == NO_TASK)
-			NG(m_head)[NG(m_info)[id].priority] = NG(m_info)[id].next;
+			NG(m_head)[priority] = NG(m_info)[id].next;
 		else
 			NG(m_info)[NG(m_info)[id].prev].next = NG(m_info)[id].next;
 
 		if (NG(m_info)[id].next == NO_TASK)
-			NG(m_tail)[NG(m_info)[id].priority] = NG(m_info)[id].prev;
+			NG(m_tail)[priority] = NG(m_info)[id].prev;
 		else
 			NG(m_info)[NG(m_info)[id].next].prev = NG(m_info)[id].prev;
 
-		NG(m_info)[id].prev = NO_TASK;
-		NG(m_info)[id].next = NO_TASK;
-		NG(m_info)[id].priority = NOT_SCHEDULED;
-		check_structs_are_valid();
-		retVal = SUCCESS;
+		if(NG(m_head)[priority] == NO_TASK)
+			NG(m_ready) &= ~READY_BIT(priority);
 	}
+
+	NG(m_info)[id].prev = NO_TASK;
+	NG(m_info)[id].next = NO_TASK;
+	NG(m_info)[id].priority = NOT_SCHEDULED;
+	check_structs_are_valid();
+	return SUCCESS;
+}
+
+__LINK_C error_t sched_post_handle_prio(task_handle_t handle, uint8_t priority)
+{
+	timer_tick_t now = get_timestamp();
+	start_atomic();
+	error_t retVal = post_task(handle, priority, now);
 	end_atomic();
 	return retVal;
 }
 
-static uint8_t pop_task(int priority)
+__LINK_C error_t sched_post_task_prio(task_t task, uint8_t priority)
 {
-	uint8_t id = NO_TASK;
-	check_structs_are_valid();
+	timer_tick_t now = get_timestamp();
+	start_atomic();
+	error_t retVal = post_task(get_task_id(task), priority, now);
+	end_atomic();
+	return retVal;
+}
+
+__LINK_C error_t sched_post_handle_deadline(task_handle_t handle, uint32_t deadline)
+{
+	timer_tick_t now = get_timestamp();
+	start_atomic();
+	error_t retVal = post_deadline_task(handle, deadline, now);
+	end_atomic();
+	return retVal;
+}
+
+__LINK_C error_t sched_post_task_deadline(task_t task, uint32_t deadline)
+{
+	timer_tick_t now = get_timestamp();
 	start_atomic();
-	if (NG(m_head)[priority] != NO_TASK)
+	error_t retVal = post_deadline_task(get_task_id(task), deadline, now);
+	end_atomic();
+	return retVal;
+}
+
+__LINK_C uint32_t sched_get_missed_deadlines()
+{
+	return NG(m_missed_deadlines);
+}
+
+__LINK_C error_t sched_cancel_handle(task_handle_t handle)
+{
+	start_atomic();
+	error_t retVal = cancel_task(handle);
+	end_atomic();
+	return retVal;
+}
+
+__LINK_C error_t sched_cancel_task(task_t task)
+{
+	start_atomic();
+	error_t retVal = cancel_task(get_task_id(task));
+	end_atomic();
+	return retVal;
+}
+
+__LINK_C error_t sched_post_event_prio(event_handler_t handler, void* arg, uint8_t priority)
+{
+	if(handler == 0x0)
+		return EINVAL;
+	if(priority > MIN_PRIORITY || priority < MAX_PRIORITY)
+		return ESIZE;
+
+	start_atomic();
+	check_structs_are_valid();
+	uint8_t id = NG(m_free_event);
+	if(id == NO_EVENT)
 	{
-		id = NG(m_head)[priority];
-		NG(m_head)[priority] = NG(m_info)[NG(m_head)[priority]].next;
-		if(NG(m_head)[priority] == NO_TASK)
-			NG(m_tail)[priority] = NO_TASK;
-		else
-			NG(m_info)[NG(m_head)[priority]].prev = NO_TASK;
+		end_atomic();
+		return ENOMEM;
+	}
 
-		NG(m_info)[id].next = NO_TASK;
-		NG(m_info)[id].prev = NO_TASK;
-		NG(m_info)[id].priority = NOT_SCHEDULED;
+	NG(m_free_event) = NG(m_events)[id].next;
+	NG(m_events)[id].handler = handler;
+	NG(m_events)[id].arg = arg;
+	NG(m_events)[id].next = NO_EVENT;
+	if(NG(m_event_head)[priority] == NO_EVENT)
+	{
+		NG(m_event_head)[priority] = id;
+		NG(m_events_ready) |= READY_BIT(priority);
 	}
+	else
+		NG(m_events)[NG(m_event_tail)[priority]].next = id;
+
+	NG(m_event_tail)[priority] = id;
+	check_structs_are_valid();
 	end_atomic();
+	return SUCCESS;
+}
+
+//must be called with interrupts disabled, the record is returned to the pool before the handler runs
+static void pop_event(uint8_t priority, event_info_t* event)
+{
+	uint8_t id = NG(m_event_head)[priority];
+	assert(id != NO_EVENT);
+	*event = NG(m_events)[id];
+	NG(m_event_head)[priority] = NG(m_events)[id].next;
+	if(NG(m_event_head)[priority] == NO_EVENT)
+	{
+		NG(m_event_tail)[priority] = NO_EVENT;
+		NG(m_events_ready) &= ~READY_BIT(priority);
+	}
+
+	NG(m_events)[id].handler = 0x0;
+	NG(m_events)[id].next = NG(m_free_event);
+	NG(m_free_event) = id;
+	check_structs_are_valid();
+}
+
+//must be called with interrupts disabled
+static uint8_t pop_deadline_task()
+{
+	uint8_t id = NG(m_deadline_head);
+	NG(m_deadline_head) = NG(m_info)[id].next;
+	if(NG(m_deadline_head) != NO_TASK)
+		NG(m_info)[NG(m_deadline_head)].prev = NO_TASK;
+
+	NG(m_info)[id].next = NO_TASK;
+	NG(m_info)[id].prev = NO_TASK;
+	NG(m_info)[id].priority = NOT_SCHEDULED;
+	check_structs_are_valid();
+	return id;
+}
+
+//must be called with interrupts disabled
+static uint8_t pop_task(uint8_t priority)
+{
+	uint8_t id = NG(m_head)[priority];
+	NG(m_head)[priority] = NG(m_info)[id].next;
+	if(NG(m_head)[priority] == NO_TASK)
+	{
+		NG(m_tail)[priority] = NO_TASK;
+		NG(m_ready) &= ~READY_BIT(priority);
+	}
+	else
+		NG(m_info)[NG(m_head)[priority]].prev = NO_TASK;
+
+	NG(m_info)[id].next = NO_TASK;
+	NG(m_info)[id].prev = NO_TASK;
+	NG(m_info)[id].priority = NOT_SCHEDULED;
 	check_structs_are_valid();
 	return id;
 }
 
-static inline bool tasks_waiting(int priority)
+#ifdef FRAMEWORK_SCHEDULER_INSTRUMENTATION
+__LINK_C error_t sched_get_task_stats(task_handle_t handle, sched_task_stats_t* stats)
 {
-	return NG(m_head)[priority] != NO_TASK;
+	if(handle >= NG(num_registered_tasks))
+		return EINVAL;
+
+	start_atomic();
+	*stats = NG(m_stats)[handle];
+	stats->task = NG(m_info)[handle].task;
+	end_atomic();
+	return SUCCESS;
 }
 
+__LINK_C void sched_reset_stats()
+{
+	start_atomic();
+	memset(NG(m_stats), 0, sizeof(NG(m_stats)));
+	end_atomic();
+}
+
+__LINK_C void sched_log_stats()
+{
+	sched_task_stats_t stats;
+	for(task_handle_t handle = 0; sched_get_task_stats(handle, &stats) == SUCCESS; handle++)
+		log_print_task_stats(handle, &stats);
+}
+#endif
+
 static uint8_t low_power_mode = FRAMEWORK_SCHEDULER_LP_MODE;
 
 uint8_t sched_get_low_power_mode(void) {
@@ -337,30 +624,90 @@ void sched_set_low_power_mode(uint8_t mode) {
   low_power_mode = mode;
 }
 
+//rounded down, so a wake-up latency shorter than a tick does not wake up the MCU a full tick early
+static timer_tick_t us_to_ticks(uint32_t us)
+{
+	return (timer_tick_t)((((uint64_t)us) * TIMER_TICKS_PER_SEC) / 1000000);
+}
+
+static uint8_t select_low_power_mode()
+{
+	//select the deepest mode allowed which we can wake up from before the next timer event is due
+	timer_tick_t delay = timer_get_next_event_delay();
+	uint8_t mode;
+	for(mode = low_power_mode; mode > 0; mode--)
+	{
+		uint32_t latency = hw_get_lowpower_mode_wakeup_latency(mode);
+		if(latency == HW_LOWPOWER_MODE_UNSUPPORTED)
+			continue;
+
+		if(latency == HW_LOWPOWER_MODE_NO_TIMER)
+		{
+			if(delay == TIMER_NO_EVENT_PENDING)
+				break;
+
+			continue;
+		}
+
+		if(delay == TIMER_NO_EVENT_PENDING || latency < ((uint64_t)delay) * 1000000 / TIMER_TICKS_PER_SEC)
+			break;
+	}
+
+	uint32_t latency = hw_get_lowpower_mode_wakeup_latency(mode);
+	timer_set_wakeup_latency(latency < HW_LOWPOWER_MODE_NO_TIMER ? us_to_ticks(latency) : 0);
+	return mode;
+}
+
 __LINK_C void scheduler_run()
 {
 	while(1)
 	{
-		while(NG(current_priority) < NUM_PRIORITIES)
+		start_atomic();
+		while(NG(m_deadline_head) != NO_TASK || (NG(m_ready) | NG(m_events_ready)) != 0)
 		{
-			check_structs_are_valid();
-			for(uint8_t id = pop_task((NG(current_priority))); id != NO_TASK; id = pop_task(NG(current_priority)))
+			if(NG(m_deadline_head) != NO_TASK)
+			{
+				uint8_t id = pop_deadline_task();
+				timer_tick_t deadline = NG(m_deadline)[id];
+				end_atomic();
+				timer_tick_t start = timer_get_counter_value();
+				if(deadline_before(deadline, start))
+					NG(m_missed_deadlines)++;
+
+				timer_record_dispatch(NG(m_info)[id].task, 0x0, 0x0);
+				NG(m_info)[id].task();
+				record_run(id, start, get_timestamp());
+				start_atomic();
+				continue;
+			}
+
+			//the highest priority with tasks or events waiting, in constant time.
+			//at the same priority, events are handled before tasks
+			uint8_t priority = __builtin_clz(NG(m_ready) | NG(m_events_ready));
+			if(NG(m_events_ready) & READY_BIT(priority))
 			{
-				check_structs_are_valid();
+				event_info_t event;
+				pop_event(priority, &event);
+				end_atomic();
+				timer_record_dispatch(0x0, event.handler, event.arg);
+				event.handler(event.arg);
+			}
+			else
+			{
+				uint8_t id = pop_task(priority);
+				end_atomic();
+				timer_tick_t start = get_timestamp();
+				timer_record_dispatch(NG(m_info)[id].task, 0x0, 0x0);
 				NG(m_info)[id].task();
+				record_run(id, start, get_timestamp());
 			}
-			//this needs to be done atomically since otherwise we risk decrementing the current priority
-			//while a higher priority task is waiting in the queue
 			start_atomic();
-			if (!tasks_waiting(NG(current_priority)))
-				NG(current_priority)++;
-#ifndef NDEBUG
-			for(int i = 0; i < NG(current_priority); i++)
-				assert(!tasks_waiting(i));
-#endif
-			end_atomic();
 		}
-		hw_enter_lowpower_mode(low_power_mode);
+		end_atomic();
+		uint8_t mode = select_low_power_mode();
+		//reconfiguring the timer can post a task which is already due
+		if(NG(m_deadline_head) == NO_TASK && (NG(m_ready) | NG(m_events_ready)) == 0)
+			hw_enter_lowpower_mode(mode);
 	}
 
 }
@@ -29,11 +29,14 @@
 
 
 #define CMD_BUFFER_SIZE 512
+#define RX_RING_SIZE 256 // a power of two
 #define CMD_HANDLER_REGISTRATIONS_COUNT 3 // TODO configurable using cmake
 #define CMD_HANDLER_ID_NOT_SET -1
 
 #include "hwuart.h"
+#include "spsc_ring.h"
 #include "scheduler.h"
+#include "timer.h"
 #include "hwsystem.h"
 #include "hwatomic.h"
 #include "debug.h"
@@ -49,11 +52,58 @@ static uint8_t NGDEF(_cmd_buffer)[CMD_BUFFER_SIZE] = { 0 };
 static fifo_t NGDEF(_cmd_fifo);
 #define cmd_fifo NG(_cmd_fifo)
 
+// the bytes received by the UART interrupt handler, which are moved to the cmd_fifo by process_cmd_fifo(),
+// so neither has to disable interrupts
+static uint8_t NGDEF(_rx_buffer)[RX_RING_SIZE];
+#define rx_buffer NG(_rx_buffer)
+
+static spsc_ring_t NGDEF(_rx_ring);
+#define rx_ring NG(_rx_ring)
+
 static cmd_handler_registration_t NGDEF(_cmd_handler_registrations)[CMD_HANDLER_REGISTRATIONS_COUNT];
 #define cmd_handler_registrations NG(_cmd_handler_registrations)
 
 static bool echo = false;
 
+#ifdef FRAMEWORK_SCHEDULER_INSTRUMENTATION
+static void print_task_stats()
+{
+    sched_task_stats_t stats;
+    console_print("id task       runs       avg exec   max exec   avg latency max latency (ticks)\r\n");
+    for(task_handle_t handle = 0; sched_get_task_stats(handle, &stats) == SUCCESS; handle++)
+    {
+        console_printf("%-2d %-10p %-10lu %-10lu %-10lu %-11lu %lu\r\n", handle, stats.task, (unsigned long)stats.runs,
+                       (unsigned long)(stats.runs ? stats.total_exec_time / stats.runs : 0), (unsigned long)stats.max_exec_time,
+                       (unsigned long)(stats.runs ? stats.total_latency / stats.runs : 0), (unsigned long)stats.max_latency);
+    }
+
+    console_printf("missed deadlines: %lu\r\n", (unsigned long)sched_get_missed_deadlines());
+}
+#endif
+
+#ifdef FRAMEWORK_TIMER_INSTRUMENTATION
+static void print_latency_stats(char* name, timer_latency_stats_t* stats)
+{
+    console_printf("%-9s %-10lu %-10lu %-10lu", name, (unsigned long)stats->count,
+                   (unsigned long)(stats->count ? stats->min : 0), (unsigned long)stats->max);
+    for(uint8_t i = 0; i < TIMER_STATS_HISTOGRAM_SIZE; i++)
+    {
+        console_printf(" %-6lu", (unsigned long)stats->histogram[i]);
+    }
+
+    console_print("\r\n");
+}
+
+static void print_timer_stats()
+{
+    timer_stats_t stats;
+    timer_get_stats(&stats);
+    console_print("latency   count      min        max        histogram: 0, 1, <4, <8, <16, <32, <64, more (ticks)\r\n");
+    print_latency_stats("fire", &stats.fire_latency);
+    print_latency_stats("dispatch", &stats.dispatch_latency);
+}
+#endif
+
 static void process_shell_cmd(char cmd)
 {
     switch(cmd)
@@ -66,6 +116,26 @@ static void process_shell_cmd(char cmd)
         case 'R':
             hw_reset();
             break;
+#ifdef FRAMEWORK_SCHEDULER_INSTRUMENTATION
+        case 'S':
+            print_task_stats();
+            break;
+#endif
+#ifdef FRAMEWORK_TIMER_INSTRUMENTATION
+        case 'T':
+            print_timer_stats();
+            break;
+#endif
+#if defined(FRAMEWORK_SCHEDULER_INSTRUMENTATION) || defined(FRAMEWORK_TIMER_INSTRUMENTATION)
+        case 'Z':
+#ifdef FRAMEWORK_SCHEDULER_INSTRUMENTATION
+            sched_reset_stats();
+#endif
+#ifdef FRAMEWORK_TIMER_INSTRUMENTATION
+            timer_reset_stats();
+#endif
+            break;
+#endif
         default:
             // TODO log
             break;
@@ -93,12 +163,39 @@ static cmd_handler_t get_cmd_handler_callback(int8_t id)
 // ATx\r : shell command, where x is a char which maps to a command.
 // List of supported commands:
 // - R: reboot device
+// - S: print the execution statistics of the scheduled tasks (requires FRAMEWORK_SCHEDULER_INSTRUMENTATION)
+// - Z: clear the execution statistics of the scheduled tasks (requires FRAMEWORK_SCHEDULER_INSTRUMENTATION)
 // AT$<command handler id> : command to be handled by the command handler specified. The command handler id is a byte < 65 (non ASCII)
 // The handlers are passed the command fifo (including the header) and are responsible for pop()-ing the bytes which are processed by the handler.
 // When the fifo does not yet contain a full command which can be processed by the specific handler nothing should be popped and the handler will
 // called again later when more data is received.
+static void receive_rx_bytes()
+{
+    // the cmd_fifo wraps at most once, bytes which don't fit stay in the rx_ring
+    for(uint8_t i = 0; i < 2; i++)
+    {
+        uint8_t* region;
+        uint16_t len = fifo_reserve(&cmd_fifo, &region);
+        len = spsc_ring_pop(&rx_ring, region, len);
+        if(len == 0)
+            return;
+
+        if(echo)
+        {
+            for(uint16_t j = 0; j < len; j++)
+            {
+                console_print_byte(region[j]);
+                if(region[j] == '\r') { console_print_byte('\n'); }
+            }
+        }
+
+        fifo_commit(&cmd_fifo, len);
+    }
+}
+
 static void process_cmd_fifo()
 {
+    receive_rx_bytes();
     if(fifo_get_size(&cmd_fifo) >= SHELL_CMD_HEADER_SIZE)
     {
         uint8_t cmd_header[SHELL_CMD_HEADER_SIZE];
@@ -138,19 +235,8 @@ static void process_cmd_fifo()
 
 static void uart_rx_cb(uint8_t data)
 {
-    if( echo ) {
-      console_print_byte(data);
-      if( data == '\r' ) { console_print_byte('\n'); }
-    }
-
-    error_t err;
-
-    start_atomic();
-        err = fifo_put(&cmd_fifo, &data, 1); assert(err == SUCCESS);
-    end_atomic();
-
-    if(!sched_is_scheduled(&process_cmd_fifo))
-        sched_post_task(&process_cmd_fifo);
+    error_t err = spsc_ring_put_byte(&rx_ring, data); assert(err == SUCCESS);
+    sched_post_task(&process_cmd_fifo);
 }
 
 void shell_init()
@@ -162,6 +248,7 @@ void shell_init()
     }
 
     fifo_init(&cmd_fifo, cmd_buffer, sizeof(cmd_buffer));
+    spsc_ring_init(&rx_ring, rx_buffer, sizeof(rx_buffer));
 
     console_set_rx_interrupt_callback(&uart_rx_cb);
     console_rx_interrupt_enable();
@@ -0,0 +1,95 @@
+/* * OSS-7 - An opensource implementation of the DASH7 Alliance Protocol for ultra
+ * lowpower wireless sensor communication
+ *
+ * Copyright 2015 University of Antwerp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*! \file spsc_ring.c
+ */
+
+#include "spsc_ring.h"
+#include "string.h"
+#include "errors.h"
+#include "debug.h"
+
+// the producer and the consumer run on the same core (an interrupt handler and a task), so it suffices that the
+// compiler does not move the accesses to the buffer across the updates of the indices
+#define SPSC_RING_BARRIER() __asm__ __volatile__("" ::: "memory")
+
+void spsc_ring_init(spsc_ring_t* ring, uint8_t* buffer, uint16_t capacity)
+{
+    assert(capacity > 0 && capacity <= 32768 && (capacity & (capacity - 1)) == 0);
+    ring->buffer = buffer;
+    ring->mask = capacity - 1;
+    ring->head = 0;
+    ring->tail = 0;
+}
+
+error_t spsc_ring_put(spsc_ring_t* ring, uint8_t* data, uint16_t len)
+{
+    uint16_t tail = ring->tail;
+    if(len > ring->mask + 1 - (uint16_t)(tail - ring->head))
+        return ESIZE;
+
+    // at most two pieces: up to the end of the buffer and after wrapping
+    uint16_t start = tail & ring->mask;
+    uint16_t part1 = ring->mask + 1 - start;
+    if(part1 > len)
+        part1 = len;
+
+    memcpy(ring->buffer + start, data, part1);
+    memcpy(ring->buffer, data + part1, len - part1);
+    SPSC_RING_BARRIER();
+    ring->tail = tail + len;
+    return SUCCESS;
+}
+
+error_t spsc_ring_put_byte(spsc_ring_t* ring, uint8_t byte)
+{
+    uint16_t tail = ring->tail;
+    if((uint16_t)(tail - ring->head) > ring->mask)
+        return ESIZE;
+
+    ring->buffer[tail & ring->mask] = byte;
+    SPSC_RING_BARRIER();
+    ring->tail = tail + 1;
+    return SUCCESS;
+}
+
+uint16_t spsc_ring_pop(spsc_ring_t* ring, uint8_t* buffer, uint16_t len)
+{
+    uint16_t head = ring->head;
+    uint16_t size = ring->tail - head;
+    SPSC_RING_BARRIER();
+    if(len > size)
+        len = size;
+
+    uint16_t start = head & ring->mask;
+    uint16_t part1 = ring->mask + 1 - start;
+    if(part1 > len)
+        part1 = len;
+
+    memcpy(buffer, ring->buffer + start, part1);
+    memcpy(buffer + part1, ring->buffer, len - part1);
+    SPSC_RING_BARRIER();
+    ring->head = head + len;
+    return len;
+}
+
+uint16_t spsc_ring_get_size(spsc_ring_t* ring)
+{
+    return ring->tail - ring->head;
+}
@@ -23,6 +23,7 @@
 #include "debug.h"
 #include "framework_defs.h"
 #include "log.h"
+#include <string.h>
 
 #if defined(FRAMEWORK_LOG_ENABLED) && defined(FRAMEWORK_TIMER_LOG_ENABLED)
   #define DPRINT(...) log_print_stack_string(LOG_STACK_FWK, __VA_ARGS__)
@@ -31,203 +32,593 @@
 #endif
 
 
-#ifdef NODE_GLOBALS
-    #warning Default Timer implementation used when NODE_GLOBALS is active. Are you sure this is what you want ??
-#endif
-
 #define HW_TIMER_ID 0
 
 #define COUNTER_OVERFLOW_INCREASE (UINT32_C(1) << (8*sizeof(hwtimer_tick_t)))
 
-static timer_event NGDEF(timers)[FRAMEWORK_TIMER_STACK_SIZE];
-static volatile timer_tick_t NGDEF(next_event);
-static volatile bool NGDEF(hw_event_scheduled);
-static volatile timer_tick_t NGDEF(timer_offset);
+//the delay before a timer tries again to post its event when the scheduler is out of event records (about 1 ms)
+#define POST_RETRY_DELAY (TIMER_TICKS_PER_SEC >= 1000 ? TIMER_TICKS_PER_SEC / 1000 : 1)
+
+//a posted timer, with its fire time on the 64-bit time line (which never overflows)
+typedef struct
+{
+    task_t f;
+    event_handler_t handler; // set instead of f for timers posting an event
+    void* arg;
+    timer_tick64_t next_event;
+    timer_tick64_t due; // the time the timer is due, next_event is later while it retries to post its event
+    timer_tick_t period; // 0 for timers which fire only once
+    timer_tick_t slack; // the number of ticks the timer may fire late
+    uint8_t priority;
+} timer_entry_t;
+
+//the posted timers are kept in a min-heap ordered on next_event, so the next event is always at the top.
+//To find the timer of a task (or of a handler and argument) they are also kept in a hash table, chained
+//through hash_next. Both refer to the timers by their index in NG(timers); unused entries are in a free list
+typedef uint16_t timer_index_t;
+
 enum
 {
     NO_EVENT = FRAMEWORK_TIMER_STACK_SIZE,
 };
 
+#if FRAMEWORK_TIMER_STACK_SIZE <= 8
+  #define HASH_SIZE 8
+#elif FRAMEWORK_TIMER_STACK_SIZE <= 32
+  #define HASH_SIZE 32
+#elif FRAMEWORK_TIMER_STACK_SIZE <= 128
+  #define HASH_SIZE 128
+#else
+  #define HASH_SIZE 512
+#endif
+
+static timer_entry_t NGDEF(timers)[FRAMEWORK_TIMER_STACK_SIZE];
+static timer_index_t NGDEF(heap)[FRAMEWORK_TIMER_STACK_SIZE];
+static timer_index_t NGDEF(heap_pos)[FRAMEWORK_TIMER_STACK_SIZE];
+static timer_index_t NGDEF(hash_next)[FRAMEWORK_TIMER_STACK_SIZE];
+static timer_index_t NGDEF(hash_head)[HASH_SIZE];
+static timer_index_t NGDEF(heap_size);
+static timer_index_t NGDEF(free_timer);
+static volatile timer_index_t NGDEF(next_event);
+static volatile timer_tick64_t NGDEF(next_fire_time);
+static volatile bool NGDEF(hw_event_scheduled);
+//the time of the last overflow of the hw timer. It is only updated from the overflow interrupt, which
+//increments offset_seq before and after, so it can be read without disabling interrupts: a reader retries
+//when offset_seq changed (or was odd) while reading
+static volatile timer_tick64_t NGDEF(timer_offset);
+static volatile uint32_t NGDEF(offset_seq);
+static volatile timer_tick_t NGDEF(wakeup_latency);
+
 static void timer_overflow();
 static void timer_fired();
 
+#ifdef FRAMEWORK_TIMER_INSTRUMENTATION
+//the number of fired timers of which the posted task or event can wait for execution at the same time.
+//When more are waiting, the dispatch latency of the others is not recorded
+#define DISPATCH_RECORDS 8
+
+typedef struct
+{
+    task_t f;
+    event_handler_t handler;
+    void* arg;
+    timer_tick_t next_event;
+} dispatch_record_t;
+
+static timer_stats_t NGDEF(stats);
+static dispatch_record_t NGDEF(dispatch_records)[DISPATCH_RECORDS];
+
+static void reset_stats()
+{
+    memset(&NG(stats), 0, sizeof(NG(stats)));
+    NG(stats).fire_latency.min = UINT32_MAX;
+    NG(stats).dispatch_latency.min = UINT32_MAX;
+}
+
+static void record_latency(timer_latency_stats_t* stats, timer_tick_t latency)
+{
+    stats->count++;
+    if(latency < stats->min)
+        stats->min = latency;
+
+    if(latency > stats->max)
+        stats->max = latency;
+
+    uint8_t bucket = latency == 0 ? 0 : 32 - __builtin_clz(latency);
+    if(bucket >= TIMER_STATS_HISTOGRAM_SIZE)
+        bucket = TIMER_STATS_HISTOGRAM_SIZE - 1;
+
+    stats->histogram[bucket]++;
+}
+
+//must be called with interrupts disabled
+static void record_fire(timer_entry_t* timer)
+{
+    //a timer is only fired once it is due
+    record_latency(&NG(stats).fire_latency, timer_get_counter_value64() - timer->due);
+
+    for(uint8_t i = 0; i < DISPATCH_RECORDS; i++)
+    {
+        if(NG(dispatch_records)[i].f == 0x0 && NG(dispatch_records)[i].handler == 0x0)
+        {
+            NG(dispatch_records)[i].f = timer->f;
+            NG(dispatch_records)[i].handler = timer->handler;
+            NG(dispatch_records)[i].arg = timer->arg;
+            NG(dispatch_records)[i].next_event = (timer_tick_t)timer->due;
+            return;
+        }
+    }
+}
+
+__LINK_C void timer_record_dispatch(task_t task, event_handler_t handler, void* arg)
+{
+    timer_tick_t counter = timer_get_counter_value();
+    start_atomic();
+    for(uint8_t i = 0; i < DISPATCH_RECORDS; i++)
+    {
+        dispatch_record_t* record = &NG(dispatch_records)[i];
+        if(record->f == task && record->handler == handler && (handler == 0x0 || record->arg == arg))
+        {
+            int32_t latency = counter - record->next_event;
+            record_latency(&NG(stats).dispatch_latency, latency > 0 ? latency : 0);
+            record->f = 0x0;
+            record->handler = 0x0;
+            break;
+        }
+    }
+    end_atomic();
+}
+
+__LINK_C void timer_get_stats(timer_stats_t* stats)
+{
+    start_atomic();
+    *stats = NG(stats);
+    end_atomic();
+}
+
+__LINK_C void timer_reset_stats()
+{
+    start_atomic();
+    reset_stats();
+    end_atomic();
+}
+
+__LINK_C void timer_log_stats()
+{
+    timer_stats_t stats;
+    timer_get_stats(&stats);
+    log_print_timer_stats(&stats);
+}
+#else
+static inline void reset_stats() {}
+static inline void record_fire(timer_entry_t* timer) {}
+#endif
+
 __LINK_C void timer_init()
 {
     for(uint32_t i = 0; i < FRAMEWORK_TIMER_STACK_SIZE; i++)
+    {
 	NG(timers)[i].f = 0x0;
+	NG(timers)[i].handler = 0x0;
+	NG(hash_next)[i] = i + 1; // the free list
+    }
+
+    for(uint32_t i = 0; i < HASH_SIZE; i++)
+	NG(hash_head)[i] = NO_EVENT;
 
+    NG(heap_size) = 0;
+    NG(free_timer) = 0;
     NG(next_event) = NO_EVENT;
     NG(timer_offset) = 0;
+    NG(offset_seq) = 0;
+    NG(wakeup_latency) = 0;
     NG(hw_event_scheduled) = false;
+    reset_stats();
+#ifdef FRAMEWORK_TIMER_INSTRUMENTATION
+    memset(NG(dispatch_records), 0, sizeof(NG(dispatch_records)));
+#endif
 
     error_t err = hw_timer_init(HW_TIMER_ID, TIMER_RESOLUTION, &timer_fired, &timer_overflow);
     assert(err == SUCCESS);
 
 }
 
-static void configure_next_event();
-__LINK_C error_t timer_post_task_prio(task_t task, timer_tick_t fire_time, uint8_t priority)
+//the timers are identified by their task, or by their handler and argument when no task is set
+static inline uint32_t hash(task_t task, event_handler_t handler, void* arg)
 {
-    error_t status = ENOMEM;
-    if (priority > MIN_PRIORITY)
-        return EINVAL;
+    uintptr_t key = task != 0x0 ? (uintptr_t)task : ((uintptr_t)handler ^ (uintptr_t)arg);
+    return (key ^ (key >> 5) ^ (key >> 11)) & (HASH_SIZE - 1);
+}
 
-    DPRINT("fire_time  <%lu>" , fire_time);
+static inline bool is_match(timer_index_t i, task_t task, event_handler_t handler, void* arg)
+{
+    if(task != 0x0)
+        return NG(timers)[i].f == task;
 
-    start_atomic();
-    uint32_t empty_index = FRAMEWORK_TIMER_STACK_SIZE;
-    for (uint32_t i = 0; i < FRAMEWORK_TIMER_STACK_SIZE; i++)
+    return NG(timers)[i].f == 0x0 && NG(timers)[i].handler == handler && NG(timers)[i].arg == arg;
+}
+
+//this function should only be called from an atomic context
+static timer_index_t find_timer(task_t task, event_handler_t handler, void* arg)
+{
+    timer_index_t i = NG(hash_head)[hash(task, handler, arg)];
+    while(i != NO_EVENT && !is_match(i, task, handler, arg))
+        i = NG(hash_next)[i];
+
+    return i;
+}
+
+static inline bool fires_before(timer_index_t a, timer_index_t b)
+{
+    return NG(timers)[a].next_event < NG(timers)[b].next_event;
+}
+
+static inline void heap_set(timer_index_t pos, timer_index_t i)
+{
+    NG(heap)[pos] = i;
+    NG(heap_pos)[i] = pos;
+}
+
+static void sift_up(timer_index_t pos)
+{
+    timer_index_t i = NG(heap)[pos];
+    while(pos > 0)
     {
-        if (NG(timers)[i].f == 0x0 && empty_index == FRAMEWORK_TIMER_STACK_SIZE)
-        {
-            empty_index = i;
-        }
-        else if (NG(timers)[i].f == task)
-        {
-            // it is allowed to update only the fire time
-            if (NG(timers)[i].priority == priority)
-            {
-                NG(timers)[empty_index].next_event = fire_time;
-                goto config;
-            }
-            else
-            //for now: do not allow an event to be scheduled more than once
-            //otherwise we risk having the same task being scheduled twice and only executed once
-            //because the scheduler disallows the same task to be scheduled multiple times
-                status = EALREADY;
+        timer_index_t parent = (pos - 1) / 2;
+        if(!fires_before(i, NG(heap)[parent]))
             break;
-        }
+
+        heap_set(pos, NG(heap)[parent]);
+        pos = parent;
+    }
+    heap_set(pos, i);
+}
+
+static void sift_down(timer_index_t pos)
+{
+    timer_index_t i = NG(heap)[pos];
+    while(true)
+    {
+        timer_index_t child = 2 * pos + 1;
+        if(child >= NG(heap_size))
+            break;
+
+        if(child + 1 < NG(heap_size) && fires_before(NG(heap)[child + 1], NG(heap)[child]))
+            child++;
+
+        if(!fires_before(NG(heap)[child], i))
+            break;
+
+        heap_set(pos, NG(heap)[child]);
+        pos = child;
     }
+    heap_set(pos, i);
+}
 
-    if (status != EALREADY && empty_index != FRAMEWORK_TIMER_STACK_SIZE)
+//this function should only be called from an atomic context
+static void remove_timer(timer_index_t i)
+{
+    //remove from the heap, by moving the last timer in its place
+    timer_index_t pos = NG(heap_pos)[i];
+    NG(heap_size)--;
+    if(pos != NG(heap_size))
     {
-        NG(timers)[empty_index].f = task;
-        NG(timers)[empty_index].next_event = fire_time;
-        NG(timers)[empty_index].priority = priority;
+        timer_index_t moved = NG(heap)[NG(heap_size)];
+        heap_set(pos, moved);
+        sift_up(pos);
+        sift_down(NG(heap_pos)[moved]);
     }
-    else
-        goto end;
 
-config:
+    //remove from the hash chain
+    timer_index_t* link = &NG(hash_head)[hash(NG(timers)[i].f, NG(timers)[i].handler, NG(timers)[i].arg)];
+    while(*link != i)
+        link = &NG(hash_next)[*link];
 
-    //if there is no event scheduled, this event will run before the next scheduled event
+    *link = NG(hash_next)[i];
+
+    NG(timers)[i].f = 0x0;
+    NG(timers)[i].handler = 0x0;
+    NG(hash_next)[i] = NG(free_timer);
+    NG(free_timer) = i;
+}
+
+//this function should only be called from an atomic context
+static void fire_timer(timer_index_t i)
+{
+    if(NG(timers)[i].f != 0x0)
+        sched_post_task_prio(NG(timers)[i].f, NG(timers)[i].priority);
+    else if(sched_post_event_prio(NG(timers)[i].handler, NG(timers)[i].arg, NG(timers)[i].priority) == ENOMEM)
     {
-        bool do_config = NG(next_event) == NO_EVENT;
+        //out of scheduler event records (for instance during a burst of received frames): keep the timer
+        //and try again POST_RETRY_DELAY later, when the scheduler has handled some of the pending events.
+        //The due time is kept, so a periodic timer is re-armed with the same phase
+        NG(timers)[i].next_event = timer_get_counter_value64() + POST_RETRY_DELAY;
+        sift_down(NG(heap_pos)[i]);
+        return;
+    }
 
-        if (!do_config)
-        {
-            uint32_t counter = timer_get_counter_value();
+    record_fire(&NG(timers)[i]);
+    if(NG(timers)[i].period == 0)
+    {
+        remove_timer(i);
+        return;
+    }
+
+    //re-arm relative to the previous fire time instead of the current time, so a periodic timer does not drift.
+    //Periods which have passed already (e.g. when the timer is fired late) are skipped
+    timer_tick64_t counter = timer_get_counter_value64();
+    do
+        NG(timers)[i].due += NG(timers)[i].period;
+    while(NG(timers)[i].due <= counter);
 
-            DPRINT("timer_post_task_prio counter value <%lu>" , counter);
+    NG(timers)[i].next_event = NG(timers)[i].due;
 
-            //if the new event should fire sooner than the old event --> trigger reconfig
-            //this is done using signed ints (compared to the current counter)
-            //to ensure propper handling of timer overflows
-            int32_t next_fire_delay = ((int32_t)fire_time) - ((int32_t)counter);
+    sift_down(NG(heap_pos)[i]);
+}
+
+static void configure_next_event();
+//either task or handler (with arg) is set
+static error_t post_timer_event(task_t task, event_handler_t handler, void* arg, timer_tick64_t fire_time, timer_tick_t slack, timer_tick_t period, uint8_t priority)
+{
+    error_t status = SUCCESS;
+    if (priority > MIN_PRIORITY)
+        return EINVAL;
 
-            DPRINT("next_fire_delay <%lu>" , next_fire_delay);
+    DPRINT("fire_time  <%lu>" , (uint32_t)fire_time);
 
-            int32_t old_fire_delay = ((int32_t)NG(timers)[NG(next_event)].next_event) - ((int32_t)counter);
-            do_config = next_fire_delay < old_fire_delay;
+    start_atomic();
+    timer_index_t i = find_timer(task, handler, arg);
+    if (i != NO_EVENT)
+    {
+        // it is allowed to update only the fire time
+        //for now: do not allow an event to be scheduled more than once
+        //otherwise we risk having the same task being scheduled twice and only executed once
+        //because the scheduler disallows the same task to be scheduled multiple times
+        if (NG(timers)[i].priority != priority)
+        {
+            status = EALREADY;
+            goto end;
         }
 
-        if (do_config)
+        bool was_next = (i == NG(next_event));
+        NG(timers)[i].next_event = fire_time;
+        NG(timers)[i].due = fire_time;
+        NG(timers)[i].slack = slack;
+        NG(timers)[i].period = period;
+        sift_up(NG(heap_pos)[i]);
+        sift_down(NG(heap_pos)[i]);
+        //the next fire time depends on all timers which can be coalesced with the next event,
+        //so reconfigure when this timer was the next event or may fire before it
+        if (was_next || fire_time <= NG(next_fire_time))
             configure_next_event();
 
-        status = SUCCESS;
+        goto end;
     }
 
+    if (NG(free_timer) == NO_EVENT)
+    {
+        status = ENOMEM;
+        goto end;
+    }
+
+    i = NG(free_timer);
+    NG(free_timer) = NG(hash_next)[i];
+    NG(timers)[i].f = task;
+    NG(timers)[i].handler = handler;
+    NG(timers)[i].arg = arg;
+    NG(timers)[i].next_event = fire_time;
+    NG(timers)[i].due = fire_time;
+    NG(timers)[i].slack = slack;
+    NG(timers)[i].period = period;
+    NG(timers)[i].priority = priority;
+
+    uint32_t h = hash(task, handler, arg);
+    NG(hash_next)[i] = NG(hash_head)[h];
+    NG(hash_head)[h] = i;
+
+    heap_set(NG(heap_size), i);
+    NG(heap_size)++;
+    sift_up(NG(heap_pos)[i]);
+
+    //if this event may run before the next scheduled event (or there is none)
+    if (NG(next_event) == NO_EVENT || fire_time <= NG(next_fire_time))
+        configure_next_event();
+
 end:
     end_atomic();
     return status;
 }
 
-__LINK_C error_t timer_cancel_task(task_t task)
+//a 32 bit time is interpreted relative to the current time: at most 2^31 ticks in the past or in the future
+static timer_tick64_t to_tick64(timer_tick_t time)
+{
+    timer_tick64_t counter = timer_get_counter_value64();
+    return counter + (int32_t)(time - (timer_tick_t)counter);
+}
+
+__LINK_C error_t timer_post_task_prio(task_t task, timer_tick_t fire_time, uint8_t priority)
+{
+    if (task == 0x0)
+        return EINVAL;
+
+    return post_timer_event(task, 0x0, 0x0, to_tick64(fire_time), 0, 0, priority);
+}
+
+__LINK_C error_t timer_post_task_prio64(task_t task, timer_tick64_t fire_time, uint8_t priority)
+{
+    if (task == 0x0)
+        return EINVAL;
+
+    return post_timer_event(task, 0x0, 0x0, fire_time, 0, 0, priority);
+}
+
+__LINK_C error_t timer_post_task_prio_slack(task_t task, timer_tick_t fire_time, timer_tick_t slack, uint8_t priority)
+{
+    if (task == 0x0)
+        return EINVAL;
+
+    return post_timer_event(task, 0x0, 0x0, to_tick64(fire_time), slack, 0, priority);
+}
+
+__LINK_C error_t timer_post_task_periodic(task_t task, timer_tick_t fire_time, timer_tick_t period, timer_tick_t slack, uint8_t priority)
+{
+    if (task == 0x0)
+        return EINVAL;
+
+    return post_timer_event(task, 0x0, 0x0, to_tick64(fire_time), slack, period, priority);
+}
+
+__LINK_C error_t timer_post_event_prio(event_handler_t handler, void* arg, timer_tick_t fire_time, uint8_t priority)
+{
+    if (handler == 0x0)
+        return EINVAL;
+
+    return post_timer_event(0x0, handler, arg, to_tick64(fire_time), 0, 0, priority);
+}
+
+__LINK_C error_t timer_post_event_prio64(event_handler_t handler, void* arg, timer_tick64_t fire_time, uint8_t priority)
+{
+    if (handler == 0x0)
+        return EINVAL;
+
+    return post_timer_event(0x0, handler, arg, fire_time, 0, 0, priority);
+}
+
+__LINK_C error_t timer_post_event_periodic(event_handler_t handler, void* arg, timer_tick_t fire_time, timer_tick_t period, timer_tick_t slack, uint8_t priority)
+{
+    if (handler == 0x0)
+        return EINVAL;
+
+    return post_timer_event(0x0, handler, arg, to_tick64(fire_time), slack, period, priority);
+}
+
+static error_t cancel_timer_event(task_t task, event_handler_t handler, void* arg)
 {
     error_t status = EALREADY;
     
     start_atomic();
-
-    for(uint32_t i = 0; i < FRAMEWORK_TIMER_STACK_SIZE; i++)
+    timer_index_t i = find_timer(task, handler, arg);
+    if(i != NO_EVENT)
     {
-      if(NG(timers)[i].f == task)
-      {
-        NG(timers)[i].f = 0x0;
+        remove_timer(i);
         //if we were the first event to fire --> trigger a reconfiguration
         if(NG(next_event) == i)
           configure_next_event();
 
         status = SUCCESS;
-        break;
-      }
     }
     end_atomic();
 
     return status;
 }
 
-__LINK_C bool timer_is_task_scheduled(task_t task)
+__LINK_C error_t timer_cancel_task(task_t task)
 {
-    bool present = false;
+    return cancel_timer_event(task, 0x0, 0x0);
+}
 
+__LINK_C error_t timer_cancel_event(event_handler_t handler, void* arg)
+{
+    return cancel_timer_event(0x0, handler, arg);
+}
+
+__LINK_C bool timer_is_task_scheduled(task_t task)
+{
     start_atomic();
+    bool present = find_timer(task, 0x0, 0x0) != NO_EVENT;
+    end_atomic();
 
-     for (uint32_t i = 0; i < FRAMEWORK_TIMER_STACK_SIZE; i++)
-     {
-       if (NG(timers)[i].f == task)
-       {
-          present = true;
-          break;
-       }
-     }
-     end_atomic();
+    return present;
+}
 
-     return present;
+__LINK_C timer_tick64_t timer_get_counter_value64()
+{
+    uint32_t seq;
+    timer_tick64_t counter;
+    do
+    {
+        seq = NG(offset_seq);
+        counter = NG(timer_offset);
+        //increase the counter with COUNTER_OVERFLOW_INCREASE
+        //if an overflow is pending. (This is to compensate for the
+        //fact that NG(timer_offset) is not updated until the overflow
+        //interrupt is actually fired. The hw counter is read again, since
+        //it may have overflowed after reading it the first time
+        hwtimer_tick_t value = hw_timer_getvalue(HW_TIMER_ID);
+        if(hw_timer_is_overflow_pending(HW_TIMER_ID))
+            counter += COUNTER_OVERFLOW_INCREASE + hw_timer_getvalue(HW_TIMER_ID);
+        else
+            counter += value;
+    }
+    while((seq & 1) || seq != NG(offset_seq));
+
+    return counter;
 }
 
 __LINK_C timer_tick_t timer_get_counter_value()
 {
-	timer_tick_t counter;
+    return (timer_tick_t)timer_get_counter_value64();
+}
+
+__LINK_C timer_tick_t timer_get_next_event_delay()
+{
+    timer_tick_t delay = TIMER_NO_EVENT_PENDING;
     start_atomic();
-	counter = NG(timer_offset) + hw_timer_getvalue(HW_TIMER_ID);
-	//increase the counter with COUNTER_OVERFLOW_INCREASE
-	//if an overflow is pending. (This is to compensate for the 
-	//fact that NG(timer_offset) is not updated until the overflow
-	//interrupt is actually fired
-	if(hw_timer_is_overflow_pending(HW_TIMER_ID))
-	    counter += COUNTER_OVERFLOW_INCREASE;
+    if(NG(next_event) != NO_EVENT)
+    {
+        timer_tick64_t counter = timer_get_counter_value64();
+        if(NG(next_fire_time) <= counter)
+            delay = 0;
+        else if(NG(next_fire_time) - counter < TIMER_NO_EVENT_PENDING)
+            delay = NG(next_fire_time) - counter;
+        else
+            delay = TIMER_NO_EVENT_PENDING - 1;
+    }
     end_atomic();
-    return counter;
+    return delay;
 }
 
-static uint32_t get_next_event()
+__LINK_C void timer_set_wakeup_latency(timer_tick_t latency)
 {
-    //this function should only be called from an atomic context
-    int32_t min_delay;
-    uint32_t next_fire_event = NO_EVENT;
-    uint32_t counter = timer_get_counter_value();
-
-    for(uint32_t i = 0; i < FRAMEWORK_TIMER_STACK_SIZE; i++)
+    start_atomic();
+    if(latency != NG(wakeup_latency))
     {
-    	if(NG(timers)[i].f == 0x0)
-    		continue;
-    	//trick borrowed from AODV: by using signed integers in this way
-    	//we know that if the event has already passed delay_ticks will be < 0
-    	// --> events are sorted from past -> future regardless of any (pending) overflows
-    	int32_t delay_ticks = ((int32_t)NG(timers)[i].next_event) - ((int32_t)counter);
-    	if(next_fire_event == NO_EVENT || delay_ticks < min_delay)
-		{
-    		min_delay = delay_ticks;
-			next_fire_event = i;
-		}
+        NG(wakeup_latency) = latency;
+        if(NG(next_event) != NO_EVENT)
+            configure_next_event();
     }
-    return next_fire_event;
+    end_atomic();
+}
+
+static inline timer_index_t get_next_event()
+{
+    //this function should only be called from an atomic context
+    return NG(heap_size) > 0 ? NG(heap)[0] : NO_EVENT;
+}
+
+//the earliest latest fire time (next_event + slack) of the timers in the subtree of the heap at pos which
+//are due before fire_time. Timers which are due later cannot lower the fire time, neither can their children
+//in the heap, so only the timers which are coalesced are visited
+static timer_tick64_t coalesce(timer_index_t pos, timer_tick64_t fire_time)
+{
+    if(pos >= NG(heap_size))
+        return fire_time;
+
+    timer_entry_t* timer = &NG(timers)[NG(heap)[pos]];
+    if(timer->next_event > fire_time)
+        return fire_time;
+
+    if(timer->next_event + timer->slack < fire_time)
+        fire_time = timer->next_event + timer->slack;
+
+    fire_time = coalesce(2 * pos + 1, fire_time);
+    return coalesce(2 * pos + 2, fire_time);
 }
 
 static void configure_next_event()
 {
     //this function should only be called from an atomic context
-	timer_tick_t next_fire_time;
+	timer_tick64_t next_fire_time;
     do
     {
 		//find the next event that has not yet passed, and schedule
@@ -237,14 +628,11 @@ static void configure_next_event()
 		if(NG(next_event) != NO_EVENT)
 		{
 			next_fire_time = NG(timers)[NG(next_event)].next_event;
-			if ( (((int32_t)next_fire_time) - ((int32_t)timer_get_counter_value())) <= 0 )
-			{
-				sched_post_task_prio(NG(timers)[NG(next_event)].f, NG(timers)[NG(next_event)].priority);
-				NG(timers)[NG(next_event)].f = 0x0;
-			}
+			if (next_fire_time <= timer_get_counter_value64())
+				fire_timer(NG(next_event));
 		}
     }
-    while(NG(next_event) != NO_EVENT && ( (((int32_t)next_fire_time) - ((int32_t)timer_get_counter_value())) <= 0  ) );
+    while(NG(next_event) != NO_EVENT && next_fire_time <= timer_get_counter_value64());
 
     //at this point NG(next_event) is eiter equal to NO_EVENT (no tasks left)
     //or we have the next event we can schedule
@@ -256,24 +644,28 @@ static void configure_next_event()
     }
     else
     {
+		//fire as late as the slack of the next event allows, but early enough for all timers which are due by then,
+		//so they are all handled in the same wake-up
+		next_fire_time = coalesce(0, next_fire_time + NG(timers)[NG(next_event)].slack);
+		NG(next_fire_time) = next_fire_time;
+
 		//calculate schedule time relative to current time rather than
 		//latest overflow time, to counteract any delays in updating counter_offset
 		//(eg when we're scheduling an event from an interrupt and thereby delaying
 		//the updating of counter_offset)
-    	timer_tick_t fire_delay = (next_fire_time - timer_get_counter_value());
+    	timer_tick64_t fire_delay = (next_fire_time - timer_get_counter_value64());
 		//if the timer should fire in less ticks than supported by the HW timer --> schedule it
 		//(otherwise it is scheduled from timer_overflow when needed)
 		if(fire_delay < COUNTER_OVERFLOW_INCREASE)
 		{
 			NG(hw_event_scheduled) = true;
-			hw_timer_schedule_delay(HW_TIMER_ID, (hwtimer_tick_t)fire_delay);
+			//wake up early enough to be running at full speed again when the event is due
+			hw_timer_schedule_delay(HW_TIMER_ID, (hwtimer_tick_t)(fire_delay > NG(wakeup_latency) ? fire_delay - NG(wakeup_latency) : 1));
 #ifndef NDEBUG	    
 			//check that we didn't try to schedule a timer in the past
 			//normally this shouldn't happen but it IS theoretically possible...
-			fire_delay = (next_fire_time - timer_get_counter_value());
-			//fire_delay should be in [0,COUNTER_OVERFLOW_INCREASE]. if this is not the case, it is because timer_get_counter() is
-			//now larger than next_fire_event, which means we 'missed' the event
-			assert(((int32_t)fire_delay) > 0);
+			//if the counter is now past next_fire_time, we 'missed' the event
+			assert(next_fire_time > timer_get_counter_value64());
 #endif
 		}
 		else
@@ -286,15 +678,20 @@ static void configure_next_event()
 }
 static void timer_overflow()
 {
+    //an odd offset_seq tells timer_get_counter_value64() that the offset is being updated
+    NG(offset_seq)++;
     NG(timer_offset) += COUNTER_OVERFLOW_INCREASE;
+    NG(offset_seq)++;
     if(NG(next_event) != NO_EVENT && 		//there is an event scheduled at THIS timer level
 	(!NG(hw_event_scheduled)) &&		//but NOT at the hw timer level
-		NG(timers)[NG(next_event)].next_event <= (NG(timer_offset) + COUNTER_OVERFLOW_INCREASE) //and the next trigger will happen before the next overflow
+		NG(next_fire_time) <= (NG(timer_offset) + COUNTER_OVERFLOW_INCREASE) //and the next trigger will happen before the next overflow
 	)
     {
 		//normally this shouldn't happen. Put an assert here just to make sure
-		assert(NG(timers)[NG(next_event)].next_event >= NG(timer_offset));
-		timer_tick_t fire_time = (NG(timers)[NG(next_event)].next_event - NG(timer_offset));
+		assert(NG(next_fire_time) >= NG(timer_offset));
+		timer_tick_t fire_time = (NG(next_fire_time) - NG(timer_offset));
+		if(fire_time > NG(wakeup_latency))
+			fire_time -= NG(wakeup_latency);
 
 		//fire time already passed
 		if(fire_time <= hw_timer_getvalue(HW_TIMER_ID))
@@ -314,8 +711,16 @@ static void timer_overflow()
 static void timer_fired()
 {
     assert(NG(next_event) != NO_EVENT);
-    assert(NG(timers)[NG(next_event)].f != 0x0);
-    sched_post_task_prio(NG(timers)[NG(next_event)].f, NG(timers)[NG(next_event)].priority);
-    NG(timers)[NG(next_event)].f = 0x0;
+    //the hw timer fires up to the wake-up latency early. When the fire time did not pass yet, schedule it again
+    //without the latency, so neither the next event nor the timers coalesced with it are fired early
+    timer_tick64_t counter = timer_get_counter_value64();
+    if(NG(next_fire_time) > counter)
+    {
+        NG(hw_event_scheduled) = true;
+        hw_timer_schedule_delay(HW_TIMER_ID, (hwtimer_tick_t)(NG(next_fire_time) - counter));
+        return;
+    }
+
+    //fires the next event and all other timers which are due
     configure_next_event();
 }
@@ -59,6 +59,25 @@ void hw_enter_lowpower_mode(uint8_t mode)
     }
 }
 
+uint32_t hw_get_lowpower_mode_wakeup_latency(uint8_t mode)
+{
+    // ACLK (driving the timer) keeps running up to LPM3, restarting the DCO dominates the wake-up time
+    switch(mode)
+    {
+        case 0:
+            return 0;
+        case 1:
+            return 5;
+        case 2:
+        case 3:
+            return 150;
+        case 4:
+            return HW_LOWPOWER_MODE_NO_TIMER;
+        default:
+            return HW_LOWPOWER_MODE_UNSUPPORTED;
+    }
+}
+
 uint64_t hw_get_unique_id()
 {
     struct s_TLV_Die_Record * pDIEREC;
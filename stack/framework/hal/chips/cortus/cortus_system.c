@@ -30,6 +30,12 @@ void hw_enter_lowpower_mode(uint8_t mode)
    // TODO
 }
 
+uint32_t hw_get_lowpower_mode_wakeup_latency(uint8_t mode)
+{
+   // only the active mode until the low power modes are implemented
+   return mode == 0 ? 0 : HW_LOWPOWER_MODE_UNSUPPORTED;
+}
+
 uint64_t hw_get_unique_id()
 {
    // TODO
@@ -27,8 +27,16 @@
 #include "em_system.h"
 #include "em_emu.h"
 #include "em_cmu.h"
+#include "platform.h"
 #include <assert.h>
 
+// wake-up from EM2/EM3 takes 2 us, but EMU_EnterEM2() only returns once the HF oscillator is restored
+#ifdef HW_USE_HFXO
+#define EM2_WAKEUP_LATENCY_US 400
+#else
+#define EM2_WAKEUP_LATENCY_US 2
+#endif
+
 void hw_enter_lowpower_mode(uint8_t mode)
 {
     switch(mode)
@@ -61,6 +69,22 @@ void hw_enter_lowpower_mode(uint8_t mode)
     }
 }
 
+uint32_t hw_get_lowpower_mode_wakeup_latency(uint8_t mode)
+{
+    switch(mode)
+    {
+        case 0:
+            return 0;
+        case 1:
+            return EM2_WAKEUP_LATENCY_US;
+        case 2:
+        case 4:
+            return HW_LOWPOWER_MODE_NO_TIMER; // the LFA clock driving the RTC is stopped
+        default:
+            return HW_LOWPOWER_MODE_UNSUPPORTED;
+    }
+}
+
 uint64_t hw_get_unique_id()
 {
     return SYSTEM_GetUnique();
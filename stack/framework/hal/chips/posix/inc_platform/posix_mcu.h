@@ -0,0 +1,123 @@
+/* * OSS-7 - An opensource implementation of the DASH7 Alliance Protocol for ultra
+ * lowpower wireless sensor communication
+ *
+ * Copyright 2015 University of Antwerp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*! \file posix_mcu.h
+ *
+ *  \brief Platform-only interface of the POSIX 'chip'.
+ *
+ *  The POSIX chip emulates the interrupt controller of an MCU using signals:
+ *  every peripheral registers a signal handler through posix_irq_register(), while
+ *  start_atomic()/end_atomic() block all registered signals. This allows the
+ *  framework to run unmodified as a regular (single-threaded) Linux process.
+ *
+ */
+
+#ifndef __POSIX_MCU_H_
+#define __POSIX_MCU_H_
+
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "link_c.h"
+
+/*! \brief The signal used by the hardware timer */
+#define POSIX_IRQ_TIMER         SIGALRM
+/*! \brief The signal raised when one of the file descriptors of a peripheral becomes readable */
+#define POSIX_IRQ_IO            SIGIO
+/*! \brief The signal used by the radio to signal the completion of a transmission */
+#define POSIX_IRQ_RADIO         (SIGRTMIN)
+
+typedef void (*posix_irq_handler_t)(void);
+
+/*! \brief Initialise the POSIX chip. Must be called before any other HAL function.
+ *
+ * \param argc	The argument count passed to main()
+ * \param argv	The argument vector passed to main(). It is used by hw_reset() to restart the process.
+ */
+__LINK_C void __posix_mcu_init(int argc, char** argv);
+
+/*! \brief Register the 'interrupt handler' for the given signal
+ *
+ * For POSIX_IRQ_IO multiple handlers can be registered: they are all invoked when
+ * the signal is raised and should poll their (non-blocking) file descriptor.
+ */
+__LINK_C void posix_irq_register(int signo, posix_irq_handler_t handler);
+
+/*! \brief Configure a file descriptor to raise POSIX_IRQ_IO when data becomes available */
+__LINK_C void posix_irq_enable_io(int fd);
+
+/*! \brief Stop raising POSIX_IRQ_IO for a file descriptor */
+__LINK_C void posix_irq_disable_io(int fd);
+
+/*! \brief The set of signals that is blocked during an atomic section */
+__LINK_C sigset_t const* posix_irq_mask();
+
+/*! \brief Block until at least one 'interrupt' has been handled since the last call.
+ *
+ * Returns immediately if an interrupt was handled in the meantime, which avoids the
+ * race between the scheduler finding its queues empty and going to sleep.
+ */
+__LINK_C void posix_irq_wait();
+
+/*! \brief Returns the argument vector that was passed to __posix_mcu_init() */
+__LINK_C char** posix_get_argv();
+
+/*! \brief A one-shot alarm, raising a signal at an absolute time of posix_clock_ns()
+ *
+ * The alarms are driven by POSIX timers, or by the virtual clock when PLATFORM_POSIX_VIRTUAL_TIME
+ * is set. The members are private to posix_clock.c.
+ */
+typedef struct
+{
+    int signo;
+    timer_t timer;
+    bool armed;
+    uint64_t fire_time;
+} posix_alarm_t;
+
+/*! \brief The time in nanoseconds on which the timers of the chip are based.
+ *
+ * This is CLOCK_MONOTONIC, or the virtual clock when PLATFORM_POSIX_VIRTUAL_TIME is set. The
+ * virtual clock only advances when the MCU is idle or busy waits: it then jumps straight to
+ * the next alarm instead of sleeping.
+ */
+__LINK_C uint64_t posix_clock_ns();
+
+/*! \brief Initialise an alarm raising signo, the handler should be registered with posix_irq_register() */
+__LINK_C void posix_alarm_init(posix_alarm_t* alarm, int signo);
+
+/*! \brief (Re)arm an alarm to fire at the given posix_clock_ns() time, a time in the past fires at once */
+__LINK_C void posix_alarm_set(posix_alarm_t* alarm, uint64_t time);
+
+/*! \brief Disarm an alarm */
+__LINK_C void posix_alarm_cancel(posix_alarm_t* alarm);
+
+/*! \brief Advance the clock by the given number of nanoseconds, without handing control to the OS */
+__LINK_C void posix_clock_busy_wait(uint64_t ns);
+
+/*! \brief With the virtual clock: jump to the first armed alarm and raise it.
+ *
+ * Should be called with the interrupts blocked: the signal is delivered when they are unblocked.
+ * Returns false if no alarm is armed or the clock is not virtual, the caller should then sleep
+ * until an interrupt arrives.
+ */
+__LINK_C bool posix_clock_fast_forward();
+
+#endif //__POSIX_MCU_H_
@@ -0,0 +1,46 @@
+/* * OSS-7 - An opensource implementation of the DASH7 Alliance Protocol for ultra
+ * lowpower wireless sensor communication
+ *
+ * Copyright 2015 University of Antwerp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*! \file posix_atomic.c
+ *
+ *  Atomic sections are implemented by blocking the signals that act as interrupts.
+ *  Sections can be nested: only the outermost end_atomic() restores the signal mask.
+ *
+ */
+
+#include <signal.h>
+
+#include "hwatomic.h"
+#include "posix_mcu.h"
+
+static volatile sig_atomic_t nesting = 0;
+static sigset_t saved_mask;
+
+void start_atomic()
+{
+    sigset_t old_mask;
+    sigprocmask(SIG_BLOCK, posix_irq_mask(), &old_mask);
+    if(nesting++ == 0)
+        saved_mask = old_mask;
+}
+
+void end_atomic()
+{
+    if(--nesting == 0)
+        sigprocmask(SIG_SETMASK, &saved_mask, NULL);
+}
@@ -0,0 +1,195 @@
+/* * OSS-7 - An opensource implementation of the DASH7 Alliance Protocol for ultra
+ * lowpower wireless sensor communication
+ *
+ * Copyright 2015 University of Antwerp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*! \file posix_clock.c
+ *
+ *  The clock and alarms on which the timer and the radio of the POSIX chip are based.
+ *
+ *  By default this is CLOCK_MONOTONIC with POSIX timers. When PLATFORM_POSIX_VIRTUAL_TIME is set
+ *  the clock is virtual: it stands still while the MCU executes, and when the scheduler goes idle
+ *  it jumps straight to the first alarm instead of sleeping. Alarms raise their signal with raise(),
+ *  so they are handled through the same interrupt path (and obey the same atomic sections) as in
+ *  real time. A long-horizon scenario (eg a day of scan automation) then completes in seconds.
+ *  Setting OSS7_VIRTUAL_TIME_LIMIT (in seconds) ends the process once the virtual clock passes it.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+
+#include "platform.h"
+#include "posix_mcu.h"
+#include "debug.h"
+
+#define NSEC_PER_SEC UINT64_C(1000000000)
+
+#ifdef PLATFORM_POSIX_VIRTUAL_TIME
+
+#define ALARMS_MAX 4
+#define TIME_LIMIT_ENV "OSS7_VIRTUAL_TIME_LIMIT"
+
+static uint64_t now = 0;
+static uint64_t time_limit = UINT64_MAX;
+static posix_alarm_t* alarms[ALARMS_MAX];
+static uint8_t alarm_count = 0;
+
+uint64_t posix_clock_ns()
+{
+    return now;
+}
+
+void posix_alarm_init(posix_alarm_t* alarm, int signo)
+{
+    if(alarm_count == 0)
+    {
+        char const* limit = getenv(TIME_LIMIT_ENV);
+        if(limit != NULL)
+            time_limit = (uint64_t)(strtod(limit, NULL) * NSEC_PER_SEC);
+    }
+
+    assert(alarm_count < ALARMS_MAX);
+    alarm->signo = signo;
+    alarm->armed = false;
+    alarms[alarm_count++] = alarm;
+}
+
+void posix_alarm_set(posix_alarm_t* alarm, uint64_t time)
+{
+    if(time <= now)
+    {
+        // delivered at once, or when the current atomic section ends
+        alarm->armed = false;
+        raise(alarm->signo);
+        return;
+    }
+
+    alarm->fire_time = time;
+    alarm->armed = true;
+}
+
+void posix_alarm_cancel(posix_alarm_t* alarm)
+{
+    alarm->armed = false;
+}
+
+static posix_alarm_t* first_alarm()
+{
+    posix_alarm_t* first = NULL;
+    for(uint8_t i = 0; i < alarm_count; i++)
+        if(alarms[i]->armed && (first == NULL || alarms[i]->fire_time < first->fire_time))
+            first = alarms[i];
+
+    return first;
+}
+
+static void advance(uint64_t time)
+{
+    if(time > time_limit)
+    {
+        fprintf(stderr, "virtual time limit of %.3f s reached\n", time_limit / (double)NSEC_PER_SEC);
+        exit(0);
+    }
+
+    now = time;
+}
+
+bool posix_clock_fast_forward()
+{
+    posix_alarm_t* alarm = first_alarm();
+    if(alarm == NULL)
+        return false;
+
+    advance(alarm->fire_time);
+    alarm->armed = false;
+    raise(alarm->signo);
+    return true;
+}
+
+void posix_clock_busy_wait(uint64_t ns)
+{
+    // fire the alarms which expire during the wait, like the interrupts which would preempt it
+    uint64_t end = now + ns;
+    posix_alarm_t* alarm;
+    while((alarm = first_alarm()) != NULL && alarm->fire_time <= end)
+    {
+        advance(alarm->fire_time);
+        alarm->armed = false;
+        raise(alarm->signo);
+    }
+
+    advance(end);
+}
+
+#else
+
+uint64_t posix_clock_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec) * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+void posix_alarm_init(posix_alarm_t* alarm, int signo)
+{
+    struct sigevent sev;
+    memset(&sev, 0, sizeof(sev));
+    sev.sigev_notify = SIGEV_SIGNAL;
+    sev.sigev_signo = signo;
+    int err = timer_create(CLOCK_MONOTONIC, &sev, &alarm->timer);
+    assert(err == 0);
+    alarm->signo = signo;
+    alarm->armed = false;
+}
+
+void posix_alarm_set(posix_alarm_t* alarm, uint64_t time)
+{
+    struct itimerspec its;
+    memset(&its, 0, sizeof(its));
+    its.it_value.tv_sec = time / NSEC_PER_SEC;
+    its.it_value.tv_nsec = time % NSEC_PER_SEC;
+    //an it_value of 0 would disarm the timer
+    if(its.it_value.tv_sec == 0 && its.it_value.tv_nsec == 0)
+        its.it_value.tv_nsec = 1;
+    timer_settime(alarm->timer, TIMER_ABSTIME, &its, NULL);
+    alarm->fire_time = time;
+    alarm->armed = true;
+}
+
+void posix_alarm_cancel(posix_alarm_t* alarm)
+{
+    struct itimerspec its;
+    memset(&its, 0, sizeof(its));
+    timer_settime(alarm->timer, 0, &its, NULL);
+    alarm->armed = false;
+}
+
+void posix_clock_busy_wait(uint64_t ns)
+{
+    uint64_t end = posix_clock_ns() + ns;
+    while(posix_clock_ns() < end);
+}
+
+bool posix_clock_fast_forward()
+{
+    return false;
+}
+
+#endif
@@ -0,0 +1,139 @@
+/* * OSS-7 - An opensource implementation of the DASH7 Alliance Protocol for ultra
+ * lowpower wireless sensor communication
+ *
+ * Copyright 2015 University of Antwerp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*! \file posix_mcu.c
+ *
+ *  Signal based 'interrupt controller' of the POSIX chip
+ *
+ */
+
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "posix_mcu.h"
+#include "debug.h"
+
+#define IO_HANDLERS_MAX 4
+
+static sigset_t irq_mask;
+static posix_irq_handler_t irq_handlers[NSIG];
+static posix_irq_handler_t io_handlers[IO_HANDLERS_MAX];
+static uint8_t io_handler_count = 0;
+static volatile sig_atomic_t irq_pending = 0;
+static char** saved_argv = NULL;
+
+static void irq_dispatch(int signo)
+{
+    if(signo == POSIX_IRQ_IO)
+    {
+        for(uint8_t i = 0; i < io_handler_count; i++)
+            io_handlers[i]();
+    }
+    else if(irq_handlers[signo] != NULL)
+        irq_handlers[signo]();
+
+    irq_pending = 1;
+}
+
+static void terminate(int signo)
+{
+    // exit() rather than the default action so atexit handlers (and gprof) get to run
+    exit(0);
+}
+
+static void install(int signo)
+{
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = &irq_dispatch;
+    sa.sa_mask = irq_mask; // irq handlers do not preempt each other
+    sa.sa_flags = SA_RESTART;
+    int err = sigaction(signo, &sa, NULL);
+    assert(err == 0);
+}
+
+__LINK_C void __posix_mcu_init(int argc, char** argv)
+{
+    saved_argv = argv;
+
+    sigemptyset(&irq_mask);
+    sigaddset(&irq_mask, POSIX_IRQ_TIMER);
+    sigaddset(&irq_mask, POSIX_IRQ_IO);
+    sigaddset(&irq_mask, POSIX_IRQ_RADIO);
+
+    install(POSIX_IRQ_IO);
+
+    signal(SIGINT, &terminate);
+    signal(SIGTERM, &terminate);
+}
+
+__LINK_C void posix_irq_register(int signo, posix_irq_handler_t handler)
+{
+    if(signo == POSIX_IRQ_IO)
+    {
+        assert(io_handler_count < IO_HANDLERS_MAX);
+        io_handlers[io_handler_count++] = handler;
+        return;
+    }
+
+    assert(sigismember(&irq_mask, signo));
+    irq_handlers[signo] = handler;
+    install(signo);
+}
+
+__LINK_C void posix_irq_enable_io(int fd)
+{
+    fcntl(fd, F_SETOWN, getpid());
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_ASYNC | O_NONBLOCK);
+}
+
+__LINK_C void posix_irq_disable_io(int fd)
+{
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_ASYNC);
+}
+
+__LINK_C sigset_t const* posix_irq_mask()
+{
+    return &irq_mask;
+}
+
+__LINK_C void posix_irq_wait()
+{
+    sigset_t old_mask;
+    sigprocmask(SIG_BLOCK, &irq_mask, &old_mask);
+    // with the virtual clock there is no need to sleep while an alarm is armed: jump to it instead
+    if(!irq_pending && !posix_clock_fast_forward())
+    {
+        sigset_t wait_mask = old_mask;
+        for(int signo = 1; signo < NSIG; signo++)
+            if(sigismember(&irq_mask, signo) == 1)
+                sigdelset(&wait_mask, signo);
+        sigsuspend(&wait_mask);
+    }
+
+    irq_pending = 0;
+    sigprocmask(SIG_SETMASK, &old_mask, NULL);
+}
+
+__LINK_C char** posix_get_argv()
+{
+    return saved_argv;
+}
@@ -0,0 +1,354 @@
+/* * OSS-7 - An opensource implementation of the DASH7 Alliance Protocol for ultra
+ * lowpower wireless sensor communication
+ *
+ * Copyright 2015 University of Antwerp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*! \file posix_radio.c
+ *
+ *  A hwradio.h implementation which exchanges frames with other processes on the same host.
+ *
+ *  Every process binds a unix datagram socket in a shared 'medium' directory (OSS7_MEDIUM_DIR,
+ *  /tmp/oss7_medium by default). Transmitting a frame sends it to all other sockets in that
+ *  directory, a process in RX on the same channel and syncword class receives it. The
+ *  transmission completes after the airtime of the frame at the data rate of the channel class.
+ *  There is no propagation model: every frame is received with the same RSSI, and frames are never lost.
+ *  With PLATFORM_POSIX_VIRTUAL_TIME the airtime elapses in virtual time, the clocks of different
+ *  processes are then unrelated.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <dirent.h>
+#include <time.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "hwradio.h"
+#include "hwsystem.h"
+#include "hwatomic.h"
+#include "posix_mcu.h"
+#include "debug.h"
+
+#define MEDIUM_DIR_ENV "OSS7_MEDIUM_DIR"
+#define MEDIUM_DIR_DEFAULT "/tmp/oss7_medium"
+
+#define RSSI_NOISE_FLOOR (-110)
+#define RSSI_RX (-60)
+#define PREAMBLE_SYNC_BYTES 6
+
+// frame header on the medium: channel header, center frequency index (2 bytes, LE), syncword class, eirp
+#define FRAME_HEADER_SIZE 5
+
+/** \brief The possible states the radio can be in
+ */
+typedef enum
+{
+    HW_RADIO_STATE_IDLE,
+    HW_RADIO_STATE_TX,
+    HW_RADIO_STATE_RX
+} hw_radio_state_t;
+
+static alloc_packet_callback_t alloc_packet_callback;
+static release_packet_callback_t release_packet_callback;
+static rx_packet_callback_t rx_packet_callback;
+static tx_packet_callback_t tx_packet_callback;
+static rssi_valid_callback_t rssi_valid_callback;
+
+static hw_radio_state_t current_state;
+static hw_radio_packet_t* current_packet;
+static hw_rx_cfg_t current_rx_cfg;
+static bool should_rx_after_tx_completed = false;
+static hw_rx_cfg_t pending_rx_cfg;
+
+static bool radio_inited = false;
+static int sock = -1;
+static posix_alarm_t tx_alarm;
+static char medium_dir[sizeof(((struct sockaddr_un*)0)->sun_path) - 32];
+static struct sockaddr_un own_addr;
+
+static void start_rx(hw_rx_cfg_t const* rx_cfg);
+
+static uint64_t tx_duration_ns(hw_radio_packet_t const* packet)
+{
+    uint32_t bits = (PREAMBLE_SYNC_BYTES + packet->length + 1) * 8;
+    if(packet->tx_meta.tx_cfg.channel_id.channel_header.ch_coding == PHY_CODING_FEC_PN9)
+        bits *= 2;
+
+    uint32_t bitrate;
+    switch(packet->tx_meta.tx_cfg.channel_id.channel_header.ch_class)
+    {
+        case PHY_CLASS_LO_RATE:
+            bitrate = 9600;
+            break;
+        case PHY_CLASS_HI_RATE:
+            bitrate = 166667;
+            break;
+        default:
+            bitrate = 55555;
+    }
+
+    return (((uint64_t)bits) * 1000000000) / bitrate;
+}
+
+static void remove_own_socket()
+{
+    if(sock >= 0)
+        unlink(own_addr.sun_path);
+}
+
+static void switch_to_idle_mode()
+{
+    current_state = HW_RADIO_STATE_IDLE;
+}
+
+static void tx_completed_isr()
+{
+    if(current_state != HW_RADIO_STATE_TX)
+        return;
+
+    switch_to_idle_mode();
+    if(tx_packet_callback != 0)
+    {
+        current_packet->tx_meta.timestamp = timer_get_counter_value();
+        tx_packet_callback(current_packet);
+    }
+
+    if(should_rx_after_tx_completed && current_state == HW_RADIO_STATE_IDLE)
+        start_rx(&pending_rx_cfg);
+
+    should_rx_after_tx_completed = false;
+}
+
+static void frame_received_isr()
+{
+    uint8_t frame[FRAME_HEADER_SIZE + 256];
+    ssize_t len;
+    while((len = recv(sock, frame, sizeof(frame), 0)) > 0)
+    {
+        if(len < FRAME_HEADER_SIZE + 1 || len != FRAME_HEADER_SIZE + frame[FRAME_HEADER_SIZE] + 1)
+            continue; // malformed
+
+        if(current_state != HW_RADIO_STATE_RX || rx_packet_callback == NULL)
+            continue;
+
+        channel_id_t channel_id = {
+            .channel_header_raw = frame[0],
+            .center_freq_index = (uint16_t)(frame[1] | (frame[2] << 8))
+        };
+
+        if(!hw_radio_channel_ids_equal(&channel_id, &current_rx_cfg.channel_id)
+                || frame[3] != current_rx_cfg.syncword_class)
+            continue;
+
+        uint8_t packet_len = frame[FRAME_HEADER_SIZE];
+        hw_radio_packet_t* packet = alloc_packet_callback(packet_len);
+        if(packet == NULL)
+            continue;
+
+        memcpy(packet->data, frame + FRAME_HEADER_SIZE, packet_len + 1);
+        packet->rx_meta.rssi = RSSI_RX;
+        packet->rx_meta.lqi = 0;
+        packet->rx_meta.rx_cfg = current_rx_cfg;
+        packet->rx_meta.crc_status = HW_CRC_UNAVAILABLE;
+        packet->rx_meta.timestamp = timer_get_counter_value();
+        rx_packet_callback(packet);
+    }
+}
+
+static void open_medium()
+{
+    char const* dir = getenv(MEDIUM_DIR_ENV);
+    snprintf(medium_dir, sizeof(medium_dir), "%s", dir != NULL ? dir : MEDIUM_DIR_DEFAULT);
+    mkdir(medium_dir, 0777);
+
+    sock = socket(AF_UNIX, SOCK_DGRAM, 0);
+    assert(sock >= 0);
+
+    memset(&own_addr, 0, sizeof(own_addr));
+    own_addr.sun_family = AF_UNIX;
+    snprintf(own_addr.sun_path, sizeof(own_addr.sun_path), "%s/%016llx",
+             medium_dir, (unsigned long long)hw_get_unique_id());
+    unlink(own_addr.sun_path);
+    int err = bind(sock, (struct sockaddr*)&own_addr, sizeof(own_addr));
+    assert(err == 0);
+    atexit(&remove_own_socket);
+
+    posix_irq_register(POSIX_IRQ_IO, &frame_received_isr);
+    posix_irq_enable_io(sock);
+}
+
+static void transmit_frame(hw_radio_packet_t const* packet)
+{
+    uint8_t frame[FRAME_HEADER_SIZE + 256];
+    hw_tx_cfg_t const* cfg = &packet->tx_meta.tx_cfg;
+    frame[0] = cfg->channel_id.channel_header_raw;
+    frame[1] = cfg->channel_id.center_freq_index & 0xFF;
+    frame[2] = cfg->channel_id.center_freq_index >> 8;
+    frame[3] = cfg->syncword_class;
+    frame[4] = (uint8_t)cfg->eirp;
+    memcpy(frame + FRAME_HEADER_SIZE, packet->data, packet->length + 1);
+    size_t frame_len = FRAME_HEADER_SIZE + packet->length + 1;
+
+    DIR* dir = opendir(medium_dir);
+    if(dir == NULL)
+        return;
+
+    struct dirent* entry;
+    while((entry = readdir(dir)) != NULL)
+    {
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        snprintf(addr.sun_path, sizeof(addr.sun_path), "%s/%s", medium_dir, entry->d_name);
+        if(entry->d_name[0] == '.' || strcmp(addr.sun_path, own_addr.sun_path) == 0)
+            continue;
+
+        if(sendto(sock, frame, frame_len, MSG_DONTWAIT, (struct sockaddr*)&addr, sizeof(addr)) < 0
+                && errno == ECONNREFUSED)
+            unlink(addr.sun_path); // left behind by a process which did not exit cleanly
+    }
+
+    closedir(dir);
+}
+
+error_t hw_radio_init(alloc_packet_callback_t alloc_packet_cb,
+                      release_packet_callback_t release_packet_cb)
+{
+    if(alloc_packet_cb == NULL || release_packet_cb == NULL)
+        return EINVAL;
+    if(radio_inited)
+        return EALREADY;
+
+    alloc_packet_callback = alloc_packet_cb;
+    release_packet_callback = release_packet_cb;
+    current_state = HW_RADIO_STATE_IDLE;
+
+    start_atomic();
+        posix_alarm_init(&tx_alarm, POSIX_IRQ_RADIO);
+        posix_irq_register(POSIX_IRQ_RADIO, &tx_completed_isr);
+        open_medium();
+        radio_inited = true;
+    end_atomic();
+    return SUCCESS;
+}
+
+static void start_rx(hw_rx_cfg_t const* rx_cfg)
+{
+    current_state = HW_RADIO_STATE_RX;
+    current_rx_cfg = *rx_cfg;
+
+    if(rssi_valid_callback != 0)
+        rssi_valid_callback(hw_radio_get_rssi());
+}
+
+error_t hw_radio_set_rx(hw_rx_cfg_t const* rx_cfg, rx_packet_callback_t rx_cb, rssi_valid_callback_t rssi_valid_cb)
+{
+    if(!radio_inited)
+        return EOFF;
+
+    rx_packet_callback = rx_cb;
+    rssi_valid_callback = rssi_valid_cb;
+
+    // if we are currently transmitting wait until TX completed before entering RX
+    if(current_state == HW_RADIO_STATE_TX)
+    {
+        should_rx_after_tx_completed = true;
+        pending_rx_cfg = *rx_cfg;
+        return SUCCESS;
+    }
+
+    start_rx(rx_cfg);
+    return SUCCESS;
+}
+
+bool hw_radio_is_rx()
+{
+    return current_state == HW_RADIO_STATE_RX || should_rx_after_tx_completed;
+}
+
+error_t hw_radio_send_packet(hw_radio_packet_t* packet, tx_packet_callback_t tx_cb)
+{
+    if(!radio_inited)
+        return EOFF;
+    if(current_state == HW_RADIO_STATE_TX)
+        return EBUSY;
+
+    tx_packet_callback = tx_cb;
+    should_rx_after_tx_completed = false;
+    current_state = HW_RADIO_STATE_TX;
+    current_packet = packet;
+
+    transmit_frame(packet);
+
+    posix_alarm_set(&tx_alarm, posix_clock_ns() + tx_duration_ns(packet));
+
+    return SUCCESS;
+}
+
+bool hw_radio_tx_busy()
+{
+    return current_state == HW_RADIO_STATE_TX;
+}
+
+bool hw_radio_rx_busy()
+{
+    // frames are delivered at once, there is never a reception 'in progress'
+    return false;
+}
+
+bool hw_radio_rssi_valid()
+{
+    return current_state == HW_RADIO_STATE_RX;
+}
+
+int16_t hw_radio_get_rssi()
+{
+    if(!hw_radio_rssi_valid())
+        return HW_RSSI_INVALID;
+
+    return RSSI_NOISE_FLOOR;
+}
+
+error_t hw_radio_set_idle()
+{
+    if(!radio_inited)
+        return EOFF;
+
+    // if we are currently transmitting wait until TX completed before entering IDLE
+    if(current_state == HW_RADIO_STATE_TX)
+    {
+        should_rx_after_tx_completed = false;
+        tx_packet_callback = NULL;
+        return SUCCESS;
+    }
+
+    if(current_state == HW_RADIO_STATE_IDLE)
+        return EALREADY;
+
+    switch_to_idle_mode();
+    return SUCCESS;
+}
+
+bool hw_radio_is_idle()
+{
+    return current_state == HW_RADIO_STATE_IDLE && !should_rx_after_tx_completed;
+}
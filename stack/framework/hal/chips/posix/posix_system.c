@@ -0,0 +1,83 @@
+/* * OSS-7 - An opensource implementation of the DASH7 Alliance Protocol for ultra
+ * lowpower wireless sensor communication
+ *
+ * Copyright 2015 University of Antwerp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*! \file posix_system.c
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <signal.h>
+
+#include "hwsystem.h"
+#include "posix_mcu.h"
+
+#define UNIQUE_ID_ENV "OSS7_UNIQUE_ID"
+
+void hw_enter_lowpower_mode(uint8_t mode)
+{
+    // there is only one 'sleep mode' on a host: suspend the process until the next interrupt
+    (void)mode;
+    posix_irq_wait();
+}
+
+uint32_t hw_get_lowpower_mode_wakeup_latency(uint8_t mode)
+{
+    (void)mode;
+    return 0;
+}
+
+uint64_t hw_get_unique_id()
+{
+    // allow the id to be fixed, so several processes can act as different (but reproducible) nodes
+    char const* id = getenv(UNIQUE_ID_ENV);
+    if(id != NULL)
+        return strtoull(id, NULL, 0);
+
+    return (((uint64_t)gethostid()) << 32) | (uint32_t)getpid();
+}
+
+void hw_busy_wait(int16_t microseconds)
+{
+    if(microseconds > 0)
+        posix_clock_busy_wait(microseconds * UINT64_C(1000));
+}
+
+void hw_reset()
+{
+    char** argv = posix_get_argv();
+    fflush(NULL);
+    // the signal mask survives execv(): make sure the new image does not start inside an atomic section
+    sigprocmask(SIG_UNBLOCK, posix_irq_mask(), NULL);
+    if(argv != NULL)
+        execv("/proc/self/exe", argv);
+
+    // could not restart the process
+    abort();
+}
+
+float hw_get_internal_temperature()
+{
+    return 25.0f;
+}
+
+uint32_t hw_get_battery(void)
+{
+    return 3000;
+}
@@ -0,0 +1,207 @@
+/* * OSS-7 - An opensource implementation of the DASH7 Alliance Protocol for ultra
+ * lowpower wireless sensor communication
+ *
+ * Copyright 2015 University of Antwerp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*! \file posix_timer.c
+ *
+ *  Emulates a free running 16-bit hardware timer on top of posix_clock_ns().
+ *
+ *  The counter is derived from the time elapsed since the last counter reset. A single
+ *  alarm (raising POSIX_IRQ_TIMER) is armed for whichever comes first: the
+ *  compare value or the next 16-bit overflow, matching the behaviour of an RTC with
+ *  a compare and an overflow interrupt. With PLATFORM_POSIX_VIRTUAL_TIME this alarm is
+ *  what the virtual clock skips to when the scheduler is idle.
+ *
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "hwtimer.h"
+#include "hwatomic.h"
+#include "posix_mcu.h"
+#include "debug.h"
+
+#define NSEC_PER_SEC UINT64_C(1000000000)
+#define COUNTER_BITS (8*sizeof(hwtimer_tick_t))
+
+static timer_callback_t compare_f = 0x0;
+static timer_callback_t overflow_f = 0x0;
+static bool timer_inited = false;
+static uint32_t ticks_per_sec;
+static posix_alarm_t timer_alarm;
+
+static uint64_t epoch_ns;           // the time of the last counter reset
+static uint64_t overflows_handled;  // the number of overflow interrupts that were delivered
+static bool compare_enabled = false;
+static uint64_t compare_tick;       // the absolute tick (since epoch) at which the compare interrupt fires
+
+static uint64_t current_tick()
+{
+    uint64_t elapsed = posix_clock_ns() - epoch_ns;
+    return (elapsed / NSEC_PER_SEC) * ticks_per_sec + ((elapsed % NSEC_PER_SEC) * ticks_per_sec) / NSEC_PER_SEC;
+}
+
+static uint64_t tick_to_ns(uint64_t tick)
+{
+    //round up, so current_tick() >= tick once the alarm expires
+    return epoch_ns + (tick / ticks_per_sec) * NSEC_PER_SEC
+            + ((tick % ticks_per_sec) * NSEC_PER_SEC + ticks_per_sec - 1) / ticks_per_sec;
+}
+
+static bool overflow_pending()
+{
+    return (current_tick() >> COUNTER_BITS) > overflows_handled;
+}
+
+static bool compare_pending()
+{
+    return compare_enabled && current_tick() >= compare_tick;
+}
+
+static void arm_alarm()
+{
+    //this function should only be called from an atomic context
+    uint64_t next_tick = (overflows_handled + 1) << COUNTER_BITS;
+    if(compare_enabled && compare_tick < next_tick)
+        next_tick = compare_tick;
+
+    posix_alarm_set(&timer_alarm, tick_to_ns(next_tick));
+}
+
+static void timer_isr()
+{
+    while(overflow_pending())
+    {
+        overflows_handled++;
+        if(overflow_f != 0x0)
+            overflow_f();
+    }
+
+    if(compare_pending())
+    {
+        compare_enabled = false;
+        if(compare_f != 0x0)
+            compare_f();
+    }
+
+    arm_alarm();
+}
+
+error_t hw_timer_init(hwtimer_id_t timer_id, uint8_t frequency, timer_callback_t compare_callback, timer_callback_t overflow_callback)
+{
+    if(timer_id >= HWTIMER_NUM)
+        return ESIZE;
+    if(timer_inited)
+        return EALREADY;
+    if(frequency != HWTIMER_FREQ_1MS && frequency != HWTIMER_FREQ_32K)
+        return EINVAL;
+
+    start_atomic();
+        compare_f = compare_callback;
+        overflow_f = overflow_callback;
+        ticks_per_sec = (frequency == HWTIMER_FREQ_1MS) ? HWTIMER_TICKS_1MS : HWTIMER_TICKS_32K;
+
+        posix_alarm_init(&timer_alarm, POSIX_IRQ_TIMER);
+        posix_irq_register(POSIX_IRQ_TIMER, &timer_isr);
+
+        epoch_ns = posix_clock_ns();
+        overflows_handled = 0;
+        compare_enabled = false;
+        timer_inited = true;
+        arm_alarm();
+    end_atomic();
+    return SUCCESS;
+}
+
+hwtimer_tick_t hw_timer_getvalue(hwtimer_id_t timer_id)
+{
+    if(timer_id >= HWTIMER_NUM || (!timer_inited))
+        return 0;
+
+    return (hwtimer_tick_t)current_tick();
+}
+
+error_t hw_timer_schedule(hwtimer_id_t timer_id, hwtimer_tick_t tick)
+{
+    if(timer_id >= HWTIMER_NUM)
+        return ESIZE;
+    if(!timer_inited)
+        return EOFF;
+
+    start_atomic();
+        uint64_t now = current_tick();
+        hwtimer_tick_t delay = tick - (hwtimer_tick_t)now;
+        //like a hardware compare register: a match on the current value only occurs after a full wrap
+        compare_tick = now + (delay == 0 ? (UINT64_C(1) << COUNTER_BITS) : delay);
+        compare_enabled = true;
+        arm_alarm();
+    end_atomic();
+    return SUCCESS;
+}
+
+error_t hw_timer_cancel(hwtimer_id_t timer_id)
+{
+    if(timer_id >= HWTIMER_NUM)
+        return ESIZE;
+    if(!timer_inited)
+        return EOFF;
+
+    start_atomic();
+        compare_enabled = false;
+        arm_alarm();
+    end_atomic();
+    return SUCCESS;
+}
+
+error_t hw_timer_counter_reset(hwtimer_id_t timer_id)
+{
+    if(timer_id >= HWTIMER_NUM)
+        return ESIZE;
+    if(!timer_inited)
+        return EOFF;
+
+    start_atomic();
+        epoch_ns = posix_clock_ns();
+        overflows_handled = 0;
+        compare_enabled = false;
+        arm_alarm();
+    end_atomic();
+    return SUCCESS;
+}
+
+bool hw_timer_is_overflow_pending(hwtimer_id_t timer_id)
+{
+    if(timer_id >= HWTIMER_NUM || (!timer_inited))
+        return false;
+
+    start_atomic();
+        bool is_pending = overflow_pending();
+    end_atomic();
+    return is_pending;
+}
+
+bool hw_timer_is_interrupt_pending(hwtimer_id_t timer_id)
+{
+    if(timer_id >= HWTIMER_NUM || (!timer_inited))
+        return false;
+
+    start_atomic();
+        bool is_pending = compare_pending();
+    end_atomic();
+    return is_pending;
+}
@@ -0,0 +1,198 @@
+/* * OSS-7 - An opensource implementation of the DASH7 Alliance Protocol for ultra
+ * lowpower wireless sensor communication
+ *
+ * Copyright 2015 University of Antwerp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*! \file posix_uart.c
+ *
+ *  UART 0 is mapped on stdin/stdout of the process, UART 1 on a pseudo terminal.
+ *  The path of the pseudo terminal is printed on stderr when the UART is initialised,
+ *  so a serial tool (eg pyserial, minicom or pylogger) can be attached to it.
+ *
+ *  Received bytes are delivered from the POSIX_IRQ_IO handler, like an RX interrupt.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <termios.h>
+#include <poll.h>
+
+#include "hwuart.h"
+#include "errors.h"
+#include "hwatomic.h"
+#include "posix_mcu.h"
+#include "debug.h"
+
+#define UARTS 2
+#define TX_TIMEOUT_MS 10
+
+struct uart_handle {
+  uint8_t idx;
+  int rx_fd;
+  int tx_fd;
+  int saved_rx_flags;
+  uint32_t baudrate;
+  bool enabled;
+  bool rx_enabled;
+};
+
+static uart_handle_t handle[UARTS] = {
+  { .idx = 0, .rx_fd = -1, .tx_fd = -1 },
+  { .idx = 1, .rx_fd = -1, .tx_fd = -1 }
+};
+
+static uart_rx_inthandler_t handler[UARTS];
+static bool io_registered = false;
+
+static void uart_io_isr()
+{
+  for(uint8_t idx = 0; idx < UARTS; idx++) {
+    if(!handle[idx].rx_enabled || handler[idx] == NULL)
+      continue;
+
+    uint8_t data[64];
+    ssize_t len;
+    while((len = read(handle[idx].rx_fd, data, sizeof(data))) > 0) {
+      for(ssize_t i = 0; i < len; i++)
+        handler[idx](data[i]);
+    }
+  }
+}
+
+static void restore_rx_flags()
+{
+  for(uint8_t idx = 0; idx < UARTS; idx++)
+    if(handle[idx].rx_fd >= 0)
+      fcntl(handle[idx].rx_fd, F_SETFL, handle[idx].saved_rx_flags);
+}
+
+static void open_pty(uart_handle_t* uart)
+{
+  int fd = posix_openpt(O_RDWR | O_NOCTTY);
+  assert(fd >= 0);
+  int err = grantpt(fd); assert(err == 0);
+  err = unlockpt(fd); assert(err == 0);
+
+  // put the terminal in raw mode: the console may carry binary data
+  struct termios tio;
+  if(tcgetattr(fd, &tio) == 0) {
+    cfmakeraw(&tio);
+    tcsetattr(fd, TCSANOW, &tio);
+  }
+
+  fprintf(stderr, "uart%d: %s\n", uart->idx, ptsname(fd));
+  uart->rx_fd = fd;
+  uart->tx_fd = fd;
+}
+
+uart_handle_t* uart_init(uint8_t idx, uint32_t baudrate, uint8_t pins) {
+  if(idx >= UARTS)
+    return NULL;
+
+  // there are no pins to route on a host
+  (void)pins;
+  handle[idx].baudrate = baudrate;
+  if(handle[idx].rx_fd < 0) {
+    if(idx == 0) {
+      handle[idx].rx_fd = STDIN_FILENO;
+      handle[idx].tx_fd = STDOUT_FILENO;
+    } else {
+      open_pty(&handle[idx]);
+    }
+
+    handle[idx].saved_rx_flags = fcntl(handle[idx].rx_fd, F_GETFL);
+  }
+
+  if(!io_registered) {
+    posix_irq_register(POSIX_IRQ_IO, &uart_io_isr);
+    atexit(&restore_rx_flags);
+    io_registered = true;
+  }
+
+  return &handle[idx];
+}
+
+bool uart_enable(uart_handle_t* uart) {
+  uart->enabled = true;
+  return true;
+}
+
+bool uart_disable(uart_handle_t* uart) {
+  uart->enabled = false;
+  return true;
+}
+
+void uart_set_rx_interrupt_callback(uart_handle_t* uart,
+                                    uart_rx_inthandler_t rx_handler)
+{
+  handler[uart->idx] = rx_handler;
+}
+
+void uart_send_byte(uart_handle_t* uart, uint8_t data) {
+  uart_send_bytes(uart, &data, 1);
+}
+
+void uart_send_bytes(uart_handle_t* uart, void const *data, size_t length) {
+  if(!uart->enabled)
+    return;
+
+  uint8_t const* ptr = (uint8_t const*)data;
+  while(length > 0) {
+    ssize_t written = write(uart->tx_fd, ptr, length);
+    if(written < 0) {
+      if(errno == EINTR)
+        continue;
+
+      // the descriptor may be non-blocking since it can be shared with the RX side: wait a bit for room
+      struct pollfd pfd = { .fd = uart->tx_fd, .events = POLLOUT };
+      if(errno == EAGAIN && poll(&pfd, 1, TX_TIMEOUT_MS) > 0)
+        continue;
+
+      // nobody is reading (eg no terminal attached to the pty): drop the data like a UART would
+      return;
+    }
+
+    ptr += written;
+    length -= written;
+  }
+}
+
+void uart_send_string(uart_handle_t* uart, const char *string) {
+  uart_send_bytes(uart, string, strnlen(string, 100));
+}
+
+error_t uart_rx_interrupt_enable(uart_handle_t* uart) {
+  if(handler[uart->idx] == NULL) { return EOFF; }
+  start_atomic();
+    uart->rx_enabled = true;
+    posix_irq_enable_io(uart->rx_fd);
+  end_atomic();
+
+  // deliver anything that was received before the interrupt was enabled
+  raise(POSIX_IRQ_IO);
+  return SUCCESS;
+}
+
+void uart_rx_interrupt_disable(uart_handle_t* uart) {
+  start_atomic();
+    uart->rx_enabled = false;
+    posix_irq_disable_io(uart->rx_fd);
+  end_atomic();
+}
@@ -113,6 +113,11 @@ static uint16_t tx_fifo_data_length = 0;
 static uint16_t rx_fifo_data_lenght = 0;
 static uint16_t expected_data_length = 0;
 
+// when FEC is used the packet is decoded in place while it is being received. The PN9 data whitening is done by the
+// radio (PKT_WHT_POLY and PKT_WHT_SEED, enabled in PKT_FIELD_1_CONFIG and PKT_FIELD_2_CONFIG) for every coding, so
+// the RX FIFO contains dewhitened data
+static fec_rx_t fec_rx;
+
 static hw_rx_cfg_t current_rx_cfg = {0x0000, PHY_SYNCWORD_CLASS0};
 static syncword_class_t current_syncword_class = PHY_SYNCWORD_CLASS0;
 
@@ -707,14 +712,18 @@ static void ezradio_handle_end_of_packet()
 
 	ezradio_fifo_info(EZRADIO_CMD_FIFO_INFO_ARG_FIFO_RX_BIT, NULL);
 
-	DPRINT_DATA(rx_packet->data, expected_data_length);
-
 	if (current_rx_cfg.channel_id.channel_header.ch_coding == PHY_CODING_FEC_PN9)
 	{
-		fec_decode_packet(rx_packet->data, expected_data_length, expected_data_length);
+		// most of the packet is decoded already while it was received, only the last bytes remain
+		fec_rx_decode(&fec_rx, rx_packet->data, rx_fifo_data_lenght);
+		fec_rx_finish(&fec_rx, rx_packet->data);
 		//assert length and data[0] can only differ 1
 	}
 
+	// a FEC packet is decoded in place, into fewer bytes than were received
+	DPRINT_DATA(rx_packet->data, current_rx_cfg.channel_id.channel_header.ch_coding == PHY_CODING_FEC_PN9 ?
+				fec_rx.output_length : expected_data_length);
+
 	DPRINT_PACKET(rx_packet, false);
 
 
@@ -778,11 +787,9 @@ static void ezradio_int_callback()
 							ezradio_read_rx_fifo(4, buffer);
 							if (current_rx_cfg.channel_id.channel_header.ch_coding == PHY_CODING_FEC_PN9)
 							{
-								uint8_t fec_buffer[4];
-								memcpy(fec_buffer, buffer, 4);
-								fec_decode_packet(fec_buffer, 4, 4);
-								expected_data_length = fec_calculated_decoded_length(fec_buffer[0]+1);
-								DPRINT("RX Packet Length: %d / %d", fec_buffer[0], expected_data_length);
+								// decodes the length byte in place, the rest of the packet follows the header
+								expected_data_length = fec_rx_start(&fec_rx, buffer);
+								DPRINT("RX Packet Length: %d / %d", buffer[0], expected_data_length);
 							} else {
 								expected_data_length = buffer[0] + 1;
 							}
@@ -797,6 +804,7 @@ static void ezradio_int_callback()
 
 							/* Read out the RX FIFO content. */
 							ezradio_read_rx_fifo(radioReplyLocal.FIFO_INFO.RX_FIFO_COUNT, &(rx_packet->data[rx_fifo_data_lenght]));
+							rx_fifo_data_lenght += radioReplyLocal.FIFO_INFO.RX_FIFO_COUNT;
 							//ezradio_read_rx_fifo(radioReplyLocal2.PACKET_INFO.LENGTH, packet->data);
 
 							ezradio_handle_end_of_packet();
@@ -811,6 +819,8 @@ static void ezradio_int_callback()
 								/* Read out the FIFO Count bytes of RX FIFO */
 								ezradio_read_rx_fifo(radioReplyLocal.FIFO_INFO.RX_FIFO_COUNT, &(rx_packet->data[rx_fifo_data_lenght]));
 								rx_fifo_data_lenght += radioReplyLocal.FIFO_INFO.RX_FIFO_COUNT;
+								if (current_rx_cfg.channel_id.channel_header.ch_coding == PHY_CODING_FEC_PN9)
+									fec_rx_decode(&fec_rx, rx_packet->data, rx_fifo_data_lenght);
 								//DPRINT("%d of %d bytes collected", rx_fifo_data_lenght, rx_packet->data[0]+1);
 								ezradio_fifo_info(0, &radioReplyLocal);
 
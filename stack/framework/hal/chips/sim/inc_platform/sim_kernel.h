@@ -0,0 +1,187 @@
+/* * OSS-7 - An opensource implementation of the DASH7 Alliance Protocol for ultra
+ * lowpower wireless sensor communication
+ *
+ * Copyright 2015 University of Antwerp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*! \file sim_kernel.h
+ *
+ *  \brief Platform-only interface of the simulator 'chip'.
+ *
+ *  The simulator runs a number of complete nodes (framework, D7AP stack and application)
+ *  inside a single process. The per-node state of the stack is kept apart by NODE_GLOBALS
+ *  (see ng.h): every NGDEF variable is an array indexed by the id of the active node.
+ *
+ *  Every node runs the regular scheduler_run() loop on a stack of its own. An event queue,
+ *  ordered by virtual time, drives the simulation: for each event the kernel
+ *  selects the node using set_node_global_id() and resumes it to handle the event, the node
+ *  hands control back to the kernel when it enters a low power mode or busy waits.
+ *  Handling an event does not consume any virtual time.
+ *
+ *  The nodes can be partitioned over several worker threads (node n is simulated by worker
+ *  n % workers), each with an event queue of its own. The workers process all events in a
+ *  window of SIM_LOOKAHEAD and exchange the events they broadcast (sim_broadcast()) at the end
+ *  of the window. Nodes only influence each other through broadcast events, which are
+ *  scheduled at least SIM_LOOKAHEAD ahead and handled by every worker at the same virtual time
+ *  and in the same order, so the results do not depend on the number of workers.
+ *
+ */
+
+#ifndef __SIM_KERNEL_H_
+#define __SIM_KERNEL_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include "link_c.h"
+
+#define SIM_NSEC_PER_SEC  UINT64_C(1000000000)
+#define SIM_NSEC_PER_USEC UINT64_C(1000)
+
+/*! \brief The minimal delay with which an event on one node can influence another node.
+ *
+ * This is the time needed to send the preamble and syncword at the highest data rate (6 bytes
+ * at 166.667 kbps), the simulated radio announces a transmission this long before it starts.
+ */
+#define SIM_LOOKAHEAD (288 * SIM_NSEC_PER_USEC)
+
+/*! \brief The type of the function executed by a node once it boots (usually ending in scheduler_run()) */
+typedef void (*sim_node_main_t)(void);
+
+/*! \brief The handler of an event.
+ *
+ * The handler is executed by the node the event was scheduled for, as if it was an interrupt
+ * handler: it runs on the stack of the node, with the node globals of that node selected.
+ */
+typedef void (*sim_event_handler_t)(void* arg, uint32_t data);
+
+/*! \brief Initialise the simulation kernel. Must be called before any other function.
+ *
+ * The command line arguments select the simulation parameters:
+ *  -n <nodes>    the number of nodes to simulate
+ *  -t <seconds>  the virtual time to simulate
+ *  -b <ms>       the nodes boot at a random moment within this period
+ *  -s <seed>     the seed of the random generator of the simulator
+ *  -u <node>     the node of which the console is written to stdout
+ *  -a <meters>   the nodes are placed at random in a square area with this side
+ *  -l <file>     read the positions of the nodes from a file instead (a line "x y" per node)
+ *  -e <exponent> the path loss exponent of the channel model
+ *  -w <dB>       the standard deviation of the (per link) log-normal shadowing
+ *  -j <workers>  the number of worker threads
+ */
+__LINK_C void sim_init(int argc, char** argv);
+
+/*! \brief The parameters of a simulation run */
+typedef struct
+{
+    size_t node_count;
+    uint64_t duration;
+    uint64_t boot_spread;
+    uint64_t seed;
+    size_t console_node;
+    double area;                    // side of the square in which the nodes are placed, in meters
+    char const* positions_file;     // NULL to place the nodes at random
+    double path_loss_exponent;
+    double shadowing;               // standard deviation in dB
+    size_t worker_count;
+} sim_config_t;
+
+/*! \brief The parameters of the simulation, as set on the command line */
+__LINK_C sim_config_t const* sim_get_config();
+
+/*! \brief Run the simulation until the simulated time has elapsed or no more events remain.
+ *
+ * \param node_main	The function every node executes when it boots.
+ */
+__LINK_C void sim_run(sim_node_main_t node_main);
+
+/*! \brief Print the statistics collected during the simulation */
+__LINK_C void sim_report(FILE* out);
+
+/*! \brief The current virtual time of the calling worker, in nanoseconds since the start of the simulation */
+__LINK_C uint64_t sim_now();
+
+/*! \brief The number of simulated nodes */
+__LINK_C size_t sim_node_count();
+
+/*! \brief The id of the node which is executing on the calling worker, or SIM_NO_NODE when called from the kernel */
+__LINK_C size_t sim_current_node();
+#define SIM_NO_NODE ((size_t)-1)
+
+/*! \brief The node of which the console output is written to stdout, or SIM_NO_NODE */
+__LINK_C size_t sim_console_node();
+
+/*! \brief A pseudo random number from the generator of the simulator itself.
+ *
+ * This generator is independent of the one used by the stack, so the behaviour of the
+ * simulator (boot times, ...) does not change when the application draws random numbers.
+ * It may only be used before the simulation starts running.
+ */
+__LINK_C uint32_t sim_random();
+
+/*! \brief The number of worker threads */
+__LINK_C size_t sim_worker_count();
+
+/*! \brief The index of the calling worker */
+__LINK_C size_t sim_worker_index();
+
+/*! \brief Schedule an event for a node
+ *
+ * \param time		The virtual time at which the event occurs, should not be in the past
+ * \param node		The node which handles the event, it should be simulated by the calling worker.
+ *			SIM_NO_NODE lets the kernel of the calling worker handle the event instead (like sim_broadcast())
+ * \param handler	The handler, executed by the node
+ * \param arg		Passed to the handler
+ * \param data		Passed to the handler
+ */
+__LINK_C void sim_schedule(uint64_t time, size_t node, sim_event_handler_t handler, void* arg, uint32_t data);
+
+/*! \brief Schedule an event for every worker
+ *
+ * The handler is executed by the kernel of every worker (not by a node), at a time which is at
+ * least SIM_LOOKAHEAD after the current time. This is the only way for a node to influence
+ * other nodes, including the nodes of its own worker.
+ */
+__LINK_C void sim_broadcast(uint64_t time, sim_event_handler_t handler, void* arg, uint32_t data);
+
+/*! \brief Suspend the current node until it has handled at least one event (low power mode) */
+__LINK_C void sim_idle();
+
+/*! \brief Suspend the current node until the given virtual time (busy wait).
+ *
+ * Events for the node are still handled while it is waiting, unless it is in an atomic
+ * section or executing an event handler itself.
+ */
+__LINK_C void sim_wait_until(uint64_t time);
+
+/*! \brief Stop the current node, it will not handle any events anymore */
+__LINK_C void sim_halt();
+
+/*! \brief Enter or leave an atomic section on the current node.
+ *
+ * While a node is in an atomic section, events for it are postponed until it is resumed.
+ */
+__LINK_C void sim_atomic_enter();
+__LINK_C void sim_atomic_exit();
+
+/*! \brief Set up the simulated medium before the simulation runs (implemented by sim_radio.c) */
+__LINK_C void sim_radio_setup();
+
+/*! \brief Print the statistics of the simulated medium (implemented by sim_radio.c) */
+__LINK_C void sim_radio_report(FILE* out, uint64_t duration);
+
+#endif //__SIM_KERNEL_H_
@@ -0,0 +1,38 @@
+/* * OSS-7 - An opensource implementation of the DASH7 Alliance Protocol for ultra
+ * lowpower wireless sensor communication
+ *
+ * Copyright 2015 University of Antwerp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*! \file sim_atomic.c
+ *
+ *  A node is never interrupted while it runs: events are only handled when it is suspended.
+ *  An atomic section only matters when a node busy waits inside it, the kernel then postpones
+ *  the events for that node until the busy wait ends.
+ *
+ */
+
+#include "hwatomic.h"
+#include "sim_kernel.h"
+
+void start_atomic()
+{
+    sim_atomic_enter();
+}
+
+void end_atomic()
+{
+    sim_atomic_exit();
+}
@@ -0,0 +1,659 @@
+/* * OSS-7 - An opensource implementation of the DASH7 Alliance Protocol for ultra
+ * lowpower wireless sensor communication
+ *
+ * Copyright 2015 University of Antwerp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*! \file sim_kernel.c
+ *
+ *  The discrete event kernel of the simulator: a binary heap of events ordered by
+ *  virtual time per worker, and a ucontext per node to run the scheduler loop of every node.
+ *
+ *  Events with the same timestamp are handled in the order in which they were scheduled,
+ *  events broadcast by the workers are imported at the end of every window ordered by time
+ *  and by the node which broadcast them, which does not depend on how the nodes are
+ *  partitioned over the workers. This makes a simulation run fully deterministic for a given
+ *  seed, whatever the number of workers.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+#include <ucontext.h>
+
+#include "sim_kernel.h"
+#include "ng.h"
+#include "debug.h"
+
+#define NODE_STACK_SIZE (64 * 1024)
+#define QUEUE_INITIAL_CAPACITY 1024
+#define BARRIER_SPINS 1000
+
+#define DEFAULT_NODE_COUNT 2
+#define DEFAULT_DURATION_S 60
+#define DEFAULT_BOOT_SPREAD_MS 1000
+#define DEFAULT_AREA_M 500
+#define DEFAULT_PATH_LOSS_EXPONENT 3.0
+#define DEFAULT_SHADOWING_DB 4.0
+
+typedef struct
+{
+    uint64_t time;
+    uint64_t seq;                   // tie breaker, keeps events with the same time in FIFO order
+    size_t node;                    // SIM_NO_NODE for a broadcast event
+    size_t source;                  // the node which broadcast the event
+    sim_event_handler_t handler;    // NULL for a boot or wake up event
+    void* arg;
+    uint32_t data;
+} sim_event_t;
+
+typedef struct
+{
+    sim_event_t* events;
+    size_t size;
+    size_t capacity;
+} event_list_t;
+
+typedef struct
+{
+    size_t index;
+    pthread_t thread;
+    ucontext_t kernel_context;
+    event_list_t queue;             // a binary heap
+    event_list_t outbox;            // the events broadcast during the current window
+    uint64_t next_seq;
+    uint64_t next_event_time;       // published at the end of every window
+    uint64_t now;
+    uint64_t events_handled;
+    uint64_t events_postponed;
+    uint64_t windows;
+} worker_t;
+
+typedef enum
+{
+    NODE_OFF,       // not booted yet
+    NODE_RUNNING,
+    NODE_IDLE,      // suspended in sim_idle()
+    NODE_WAITING,   // suspended in sim_wait_until()
+    NODE_HALTED
+} node_state_t;
+
+typedef struct
+{
+    ucontext_t context;
+    void* stack;
+    worker_t* worker;
+    node_state_t state;
+    uint64_t wake_time;             // the end of the (innermost) busy wait
+    uint32_t atomic_nesting;
+    uint32_t handler_nesting;
+    sim_event_t event;              // the event the node was resumed for
+} node_t;
+
+typedef struct
+{
+    volatile int count;
+    volatile int sense;
+} barrier_t;
+
+static sim_config_t config = {
+    .node_count = DEFAULT_NODE_COUNT,
+    .duration = DEFAULT_DURATION_S * SIM_NSEC_PER_SEC,
+    .boot_spread = DEFAULT_BOOT_SPREAD_MS * UINT64_C(1000000),
+    .seed = 1,
+    .console_node = SIM_NO_NODE,
+    .area = DEFAULT_AREA_M,
+    .positions_file = NULL,
+    .path_loss_exponent = DEFAULT_PATH_LOSS_EXPONENT,
+    .shadowing = DEFAULT_SHADOWING_DB,
+    .worker_count = 1
+};
+
+static node_t* nodes;
+static worker_t* workers;
+static sim_node_main_t node_main_f;
+static barrier_t barrier;
+static uint64_t rng_state = 1;
+static uint64_t end_time;
+static double wall_time;
+
+static __thread worker_t* worker;
+static __thread size_t current_node = SIM_NO_NODE;
+
+static bool event_before(sim_event_t const* a, sim_event_t const* b)
+{
+    return a->time < b->time || (a->time == b->time && a->seq < b->seq);
+}
+
+static bool broadcast_before(sim_event_t const* a, sim_event_t const* b)
+{
+    // the events of a node are in the outbox of a single worker, in the order they were broadcast (seq)
+    return a->time < b->time || (a->time == b->time && (a->source < b->source
+                                                        || (a->source == b->source && a->seq < b->seq)));
+}
+
+static int compare_broadcasts(void const* a, void const* b)
+{
+    return broadcast_before(a, b) ? -1 : broadcast_before(b, a) ? 1 : 0;
+}
+
+static void list_reserve(event_list_t* list)
+{
+    if(list->size == list->capacity)
+    {
+        list->capacity = list->capacity ? 2 * list->capacity : QUEUE_INITIAL_CAPACITY;
+        list->events = realloc(list->events, list->capacity * sizeof(sim_event_t));
+        assert(list->events != NULL);
+    }
+}
+
+static void queue_push(event_list_t* queue, sim_event_t const* event)
+{
+    list_reserve(queue);
+    size_t i = queue->size++;
+    while(i > 0)
+    {
+        size_t parent = (i - 1) / 2;
+        if(!event_before(event, &queue->events[parent]))
+            break;
+
+        queue->events[i] = queue->events[parent];
+        i = parent;
+    }
+
+    queue->events[i] = *event;
+}
+
+static void queue_pop(event_list_t* queue, sim_event_t* event)
+{
+    assert(queue->size > 0);
+    *event = queue->events[0];
+    sim_event_t last = queue->events[--queue->size];
+    size_t i = 0;
+    while(true)
+    {
+        size_t child = 2 * i + 1;
+        if(child >= queue->size)
+            break;
+        if(child + 1 < queue->size && event_before(&queue->events[child + 1], &queue->events[child]))
+            child++;
+        if(!event_before(&queue->events[child], &last))
+            break;
+
+        queue->events[i] = queue->events[child];
+        i = child;
+    }
+
+    queue->events[i] = last;
+}
+
+static void enqueue(worker_t* w, sim_event_t* event)
+{
+    event->seq = w->next_seq++;
+    queue_push(&w->queue, event);
+}
+
+static void barrier_wait(int* local_sense)
+{
+    // a sense reversing barrier: the windows are short, so spin before giving up the core
+    *local_sense = !*local_sense;
+    if(__atomic_sub_fetch(&barrier.count, 1, __ATOMIC_ACQ_REL) == 0)
+    {
+        __atomic_store_n(&barrier.count, (int)config.worker_count, __ATOMIC_RELAXED);
+        __atomic_store_n(&barrier.sense, *local_sense, __ATOMIC_RELEASE);
+        return;
+    }
+
+    for(int spins = 0; __atomic_load_n(&barrier.sense, __ATOMIC_ACQUIRE) != *local_sense; spins++)
+        if(spins > BARRIER_SPINS)
+            sched_yield();
+}
+
+static double wall_clock()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void usage(char const* name)
+{
+    fprintf(stderr, "usage: %s [-n nodes] [-t seconds] [-b boot_spread_ms] [-s seed] [-u console_node] [-j workers]\n"
+                    "          [-a area_m | -l positions_file] [-e path_loss_exponent] [-w shadowing_db]\n", name);
+}
+
+void sim_init(int argc, char** argv)
+{
+    int opt;
+    while((opt = getopt(argc, argv, "n:t:b:s:u:a:l:e:w:j:h")) != -1)
+    {
+        switch(opt)
+        {
+            case 'n':
+                config.node_count = strtoul(optarg, NULL, 0);
+                break;
+            case 't':
+                config.duration = (uint64_t)(strtod(optarg, NULL) * SIM_NSEC_PER_SEC);
+                break;
+            case 'b':
+                config.boot_spread = strtoull(optarg, NULL, 0) * UINT64_C(1000000);
+                break;
+            case 's':
+                config.seed = strtoull(optarg, NULL, 0);
+                break;
+            case 'u':
+                config.console_node = strtoul(optarg, NULL, 0);
+                break;
+            case 'a':
+                config.area = strtod(optarg, NULL);
+                break;
+            case 'l':
+                config.positions_file = optarg;
+                break;
+            case 'e':
+                config.path_loss_exponent = strtod(optarg, NULL);
+                break;
+            case 'w':
+                config.shadowing = strtod(optarg, NULL);
+                break;
+            case 'j':
+                config.worker_count = strtoul(optarg, NULL, 0);
+                break;
+            default:
+                usage(argv[0]);
+                exit(opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+    }
+
+    if(config.node_count == 0 || config.node_count > NODE_GLOBALS_MAX_NODES)
+    {
+        fprintf(stderr, "the number of nodes should be between 1 and %d (PLATFORM_SIM_MAX_NODES)\n",
+                NODE_GLOBALS_MAX_NODES);
+        exit(EXIT_FAILURE);
+    }
+
+    if(config.worker_count == 0 || config.worker_count > config.node_count)
+        config.worker_count = config.worker_count ? config.node_count : 1;
+
+    nodes = calloc(config.node_count, sizeof(node_t));
+    workers = calloc(config.worker_count, sizeof(worker_t));
+    assert(nodes != NULL && workers != NULL);
+    for(size_t i = 0; i < config.worker_count; i++)
+        workers[i].index = i;
+    for(size_t id = 0; id < config.node_count; id++)
+        nodes[id].worker = &workers[id % config.worker_count];
+
+    // xorshift does not work with an all zero state
+    rng_state = config.seed ? config.seed : 1;
+    sim_radio_setup();
+}
+
+sim_config_t const* sim_get_config()
+{
+    return &config;
+}
+
+uint32_t sim_random()
+{
+    // xorshift64*
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return (uint32_t)((rng_state * UINT64_C(2685821657736338717)) >> 32);
+}
+
+uint64_t sim_now()
+{
+    return worker ? worker->now : 0;
+}
+
+size_t sim_node_count()
+{
+    return config.node_count;
+}
+
+size_t sim_current_node()
+{
+    return current_node;
+}
+
+size_t sim_console_node()
+{
+    return config.console_node;
+}
+
+size_t sim_worker_count()
+{
+    return config.worker_count;
+}
+
+size_t sim_worker_index()
+{
+    return worker->index;
+}
+
+void sim_schedule(uint64_t time, size_t node, sim_event_handler_t handler, void* arg, uint32_t data)
+{
+    assert(node == SIM_NO_NODE || (node < config.node_count && nodes[node].worker == worker));
+    assert(time >= worker->now);
+
+    sim_event_t event = {
+        .time = time,
+        .node = node,
+        .handler = handler,
+        .arg = arg,
+        .data = data
+    };
+
+    enqueue(worker, &event);
+}
+
+void sim_broadcast(uint64_t time, sim_event_handler_t handler, void* arg, uint32_t data)
+{
+    assert(time >= worker->now + SIM_LOOKAHEAD);
+
+    list_reserve(&worker->outbox);
+    worker->outbox.events[worker->outbox.size] = (sim_event_t){
+        .time = time,
+        .seq = worker->outbox.size,
+        .node = SIM_NO_NODE,
+        .source = current_node,
+        .handler = handler,
+        .arg = arg,
+        .data = data
+    };
+
+    worker->outbox.size++;
+}
+
+/*
+ * node side
+ */
+
+static void suspend(node_t* node, node_state_t state)
+{
+    node->state = state;
+    swapcontext(&node->context, &node->worker->kernel_context);
+    // resumed by the kernel to handle node->event
+    node->state = NODE_RUNNING;
+}
+
+static void handle_event(node_t* node)
+{
+    // copy the event: the handler can suspend the node and have node->event overwritten
+    sim_event_t event = node->event;
+    if(event.handler == NULL)
+        return;
+
+    node->handler_nesting++;
+    event.handler(event.arg, event.data);
+    node->handler_nesting--;
+}
+
+void sim_idle()
+{
+    assert(current_node != SIM_NO_NODE);
+    node_t* node = &nodes[current_node];
+    suspend(node, NODE_IDLE);
+    handle_event(node);
+}
+
+void sim_wait_until(uint64_t time)
+{
+    assert(current_node != SIM_NO_NODE);
+    if(time <= worker->now)
+        return;
+
+    node_t* node = &nodes[current_node];
+    uint64_t outer_wake_time = node->wake_time;
+    node->wake_time = time;
+    sim_schedule(time, current_node, NULL, NULL, 0);
+    while(worker->now < time)
+    {
+        suspend(node, NODE_WAITING);
+        handle_event(node);
+    }
+
+    node->wake_time = outer_wake_time;
+}
+
+void sim_halt()
+{
+    assert(current_node != SIM_NO_NODE);
+    node_t* node = &nodes[current_node];
+    node->state = NODE_HALTED;
+    swapcontext(&node->context, &node->worker->kernel_context);
+    assert(false); // a halted node is never resumed
+}
+
+void sim_atomic_enter()
+{
+    if(current_node != SIM_NO_NODE)
+        nodes[current_node].atomic_nesting++;
+}
+
+void sim_atomic_exit()
+{
+    if(current_node != SIM_NO_NODE)
+    {
+        assert(nodes[current_node].atomic_nesting > 0);
+        nodes[current_node].atomic_nesting--;
+    }
+}
+
+static void node_entry()
+{
+    node_main_f();
+    // the main function of a node is not supposed to return
+    sim_halt();
+}
+
+/*
+ * kernel side
+ */
+
+static void resume(size_t id)
+{
+    current_node = id;
+    set_node_global_id(id);
+    swapcontext(&worker->kernel_context, &nodes[id].context);
+    current_node = SIM_NO_NODE;
+}
+
+static void boot(size_t id)
+{
+    node_t* node = &nodes[id];
+    node->stack = malloc(NODE_STACK_SIZE);
+    assert(node->stack != NULL);
+
+    getcontext(&node->context);
+    node->context.uc_stack.ss_sp = node->stack;
+    node->context.uc_stack.ss_size = NODE_STACK_SIZE;
+    node->context.uc_link = NULL;
+    makecontext(&node->context, &node_entry, 0);
+    node->state = NODE_RUNNING;
+}
+
+static void handle(sim_event_t* event)
+{
+    if(event->node == SIM_NO_NODE)
+    {
+        // broadcast event, handled by the kernel itself
+        worker->events_handled++;
+        event->handler(event->arg, event->data);
+        return;
+    }
+
+    node_t* node = &nodes[event->node];
+    switch(node->state)
+    {
+        case NODE_OFF:
+            boot(event->node);
+            break;
+        case NODE_IDLE:
+            if(event->handler == NULL)
+                return; // the wake up of a busy wait which already ended
+            break;
+        case NODE_WAITING:
+            if(event->handler != NULL && (node->atomic_nesting > 0 || node->handler_nesting > 0))
+            {
+                // interrupts are disabled: postpone the event until the busy wait ends
+                event->time = node->wake_time;
+                enqueue(worker, event);
+                worker->events_postponed++;
+                return;
+            }
+            break;
+        case NODE_HALTED:
+            return;
+        default:
+            assert(false);
+    }
+
+    node->event = *event;
+    worker->events_handled++;
+    resume(event->node);
+}
+
+static void* worker_main(void* arg)
+{
+    worker = (worker_t*)arg;
+    int local_sense = 0;
+    uint64_t window_end = 0;
+    while(true)
+    {
+        // handle all events in the window: nothing another worker does can influence them
+        while(worker->queue.size > 0 && worker->queue.events[0].time < window_end)
+        {
+            sim_event_t event;
+            queue_pop(&worker->queue, &event);
+            worker->now = event.time;
+            handle(&event);
+        }
+
+        worker->windows++;
+        qsort(worker->outbox.events, worker->outbox.size, sizeof(sim_event_t), &compare_broadcasts);
+        barrier_wait(&local_sense);
+
+        // merge the sorted outboxes, so every worker imports the broadcasts in the same order
+        size_t imported[config.worker_count];
+        memset(imported, 0, sizeof(imported));
+        while(true)
+        {
+            sim_event_t const* next = NULL;
+            size_t next_worker = 0;
+            for(size_t i = 0; i < config.worker_count; i++)
+            {
+                if(imported[i] < workers[i].outbox.size
+                        && (next == NULL || broadcast_before(&workers[i].outbox.events[imported[i]], next)))
+                {
+                    next = &workers[i].outbox.events[imported[i]];
+                    next_worker = i;
+                }
+            }
+
+            if(next == NULL)
+                break;
+
+            // the outboxes are shared, enqueue() sets the sequence number of a copy
+            sim_event_t event = *next;
+            enqueue(worker, &event);
+            imported[next_worker]++;
+        }
+
+        worker->next_event_time = worker->queue.size ? worker->queue.events[0].time : UINT64_MAX;
+        barrier_wait(&local_sense);
+
+        // everybody imported the broadcasts of the previous window
+        worker->outbox.size = 0;
+
+        // skip the windows in which nothing happens
+        uint64_t next_event_time = UINT64_MAX;
+        for(size_t i = 0; i < config.worker_count; i++)
+            if(workers[i].next_event_time < next_event_time)
+                next_event_time = workers[i].next_event_time;
+
+        if(next_event_time > config.duration)
+            break;
+
+        window_end = next_event_time + SIM_LOOKAHEAD;
+        if(window_end > config.duration + 1)
+            window_end = config.duration + 1;
+    }
+
+    worker->now = config.duration;
+    return NULL;
+}
+
+void sim_run(sim_node_main_t node_main)
+{
+    node_main_f = node_main;
+    for(size_t id = 0; id < config.node_count; id++)
+    {
+        sim_event_t event = {
+            .time = config.boot_spread ? sim_random() % config.boot_spread : 0,
+            .node = id,
+            .handler = NULL
+        };
+
+        enqueue(nodes[id].worker, &event);
+    }
+
+    barrier.count = (int)config.worker_count;
+    barrier.sense = 0;
+
+    double start = wall_clock();
+    for(size_t i = 1; i < config.worker_count; i++)
+    {
+        int err = pthread_create(&workers[i].thread, NULL, &worker_main, &workers[i]);
+        assert(err == 0);
+    }
+
+    worker_main(&workers[0]);
+    for(size_t i = 1; i < config.worker_count; i++)
+        pthread_join(workers[i].thread, NULL);
+
+    wall_time = wall_clock() - start;
+    end_time = config.duration;
+}
+
+void sim_report(FILE* out)
+{
+    size_t halted = 0;
+    for(size_t id = 0; id < config.node_count; id++)
+        if(nodes[id].state == NODE_HALTED)
+            halted++;
+
+    uint64_t events_handled = 0;
+    uint64_t events_postponed = 0;
+    for(size_t i = 0; i < config.worker_count; i++)
+    {
+        events_handled += workers[i].events_handled;
+        events_postponed += workers[i].events_postponed;
+    }
+
+    fprintf(out, "simulated %zu nodes for %.3f s in %.3f s (x%.1f) using %zu worker(s)\n", config.node_count,
+            end_time / (double)SIM_NSEC_PER_SEC, wall_time,
+            wall_time > 0 ? end_time / (double)SIM_NSEC_PER_SEC / wall_time : 0, config.worker_count);
+    fprintf(out, "events: %llu handled, %llu postponed, %llu windows, %zu nodes halted\n",
+            (unsigned long long)events_handled, (unsigned long long)events_postponed,
+            (unsigned long long)workers[0].windows, halted);
+    sim_radio_report(out, end_time);
+}
@@ -0,0 +1,645 @@
+/* * OSS-7 - An opensource implementation of the DASH7 Alliance Protocol for ultra
+ * lowpower wireless sensor communication
+ *
+ * Copyright 2015 University of Antwerp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*! \file sim_radio.c
+ *
+ *  A hwradio.h implementation for all simulated nodes, sharing one virtual medium.
+ *
+ *  A transmission occupies the medium during the airtime of the frame at the data rate of
+ *  the channel class. The received power of a link follows a log-distance path loss model
+ *  with log-normal shadowing, which is fixed per link (and the same in both directions).
+ *
+ *  A transmission starts TX_TURNAROUND after hw_radio_send_packet(). Every worker keeps a view of
+ *  the medium for its own nodes, the sender broadcasts the start and the end of the transmission
+ *  to all workers when the packet is sent, so every node sees the transmission on the medium from
+ *  its start until its end, whatever worker simulates it. A run does not depend on the number of
+ *  workers.
+ *
+ *  When a transmission ends, the frame is offered to every node which has been listening on
+ *  the same channel and syncword class since the transmission started. It is received
+ *  when the SINR over the frame, taking into account all transmissions on the same channel which
+ *  overlapped it in time, is above the capture threshold. This models both the sensitivity
+ *  (no interferers) and collisions, including the capture effect.
+ *
+ *  The RSSI reported to the stack (rssi_valid callback, hw_radio_get_rssi(), rx_meta) is the
+ *  total received power on the channel, the LQI is the SINR of the frame in dB.
+ *  Like on a real radio the RSSI only becomes valid some time after entering RX, which also
+ *  makes sure a CCA retry loop advances the virtual time.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "hwradio.h"
+#include "timer.h"
+#include "sim_kernel.h"
+#include "debug.h"
+
+#define PREAMBLE_SYNC_BYTES 6
+#define RSSI_VALID_DELAY (200 * SIM_NSEC_PER_USEC)
+#define TX_TURNAROUND SIM_LOOKAHEAD // from hw_radio_send_packet() until the preamble is on the air (ramping up the PA)
+
+#define PATH_LOSS_1M 31.2           // free space path loss at 1 m for 868 MHz, in dB
+#define CAPTURE_THRESHOLD 8.0       // the SINR needed to decode a frame, in dB
+
+/** \brief The possible states the radio can be in
+ */
+typedef enum
+{
+    HW_RADIO_STATE_IDLE,
+    HW_RADIO_STATE_TX,
+    HW_RADIO_STATE_RX
+} hw_radio_state_t;
+
+/** \brief The physical layer parameters of a channel class
+ */
+typedef struct
+{
+    uint32_t bitrate;
+    double noise_floor;             // in dBm, depends on the receiver bandwidth
+} channel_class_params_t;
+
+typedef struct
+{
+    size_t node;
+    int8_t eirp;
+} interferer_t;
+
+/** \brief A transmission, shared by all workers and read-only once it was sent
+ */
+typedef struct
+{
+    size_t sender;
+    int8_t eirp;
+    channel_id_t channel_id;
+    syncword_class_t syncword_class;
+    uint64_t start;
+    uint64_t end;
+    uint32_t refs;                  // the sender, the views of the workers and the receivers which did not handle the frame yet
+    uint8_t data[256];
+} transmission_t;
+
+/** \brief A transmission as seen by the nodes of one worker
+ */
+typedef struct medium_entry
+{
+    struct medium_entry* next;      // in the list of ongoing transmissions
+    transmission_t* tx;
+    interferer_t* interferers;      // the transmissions on the same channel which overlapped this one
+    uint32_t interferer_count;
+    uint32_t interferer_capacity;
+} medium_entry_t;
+
+/** \brief The view of the medium of a worker, and the statistics collected by it
+ */
+typedef struct
+{
+    medium_entry_t* ongoing;
+    uint64_t tx_frames;
+    uint64_t tx_overlapped;
+    uint64_t airtime;
+    uint64_t rx_frames;
+    uint64_t rx_collided;
+    uint64_t rx_weak;
+} medium_t;
+
+typedef struct
+{
+    bool inited;
+    alloc_packet_callback_t alloc_packet_callback;
+    release_packet_callback_t release_packet_callback;
+    rx_packet_callback_t rx_packet_callback;
+    tx_packet_callback_t tx_packet_callback;
+    rssi_valid_callback_t rssi_valid_callback;
+
+    hw_radio_state_t current_state;
+    hw_radio_packet_t* current_packet;
+    hw_rx_cfg_t current_rx_cfg;
+    uint64_t rx_start;              // since when the node listens on current_rx_cfg
+    bool should_rx_after_tx_completed;
+    hw_rx_cfg_t pending_rx_cfg;
+    uint32_t rssi_generation;       // invalidates a pending rssi_valid event
+} radio_t;
+
+typedef struct
+{
+    double x;
+    double y;
+} position_t;
+
+static radio_t* radios;
+static position_t* positions;
+static medium_t* media;             // one per worker
+
+static void start_rx(hw_rx_cfg_t const* rx_cfg);
+
+static radio_t* current_radio()
+{
+    return &radios[sim_current_node()];
+}
+
+static medium_t* current_medium()
+{
+    return &media[sim_worker_index()];
+}
+
+static channel_class_params_t const* class_params(phy_channel_class_t ch_class)
+{
+    static const channel_class_params_t lo_rate = { .bitrate = 9600, .noise_floor = -121.0 };
+    static const channel_class_params_t normal_rate = { .bitrate = 55555, .noise_floor = -113.0 };
+    static const channel_class_params_t hi_rate = { .bitrate = 166667, .noise_floor = -108.0 };
+    switch(ch_class)
+    {
+        case PHY_CLASS_LO_RATE:
+            return &lo_rate;
+        case PHY_CLASS_HI_RATE:
+            return &hi_rate;
+        default:
+            return &normal_rate;
+    }
+}
+
+static uint64_t tx_duration(hw_radio_packet_t const* packet)
+{
+    uint32_t bits = (PREAMBLE_SYNC_BYTES + packet->length + 1) * 8;
+    if(packet->tx_meta.tx_cfg.channel_id.channel_header.ch_coding == PHY_CODING_FEC_PN9)
+        bits *= 2;
+
+    uint32_t bitrate = class_params(packet->tx_meta.tx_cfg.channel_id.channel_header.ch_class)->bitrate;
+    return (((uint64_t)bits) * SIM_NSEC_PER_SEC) / bitrate;
+}
+
+static void place_nodes()
+{
+    sim_config_t const* config = sim_get_config();
+    positions = calloc(sim_node_count(), sizeof(position_t));
+    assert(positions != NULL);
+
+    if(config->positions_file == NULL)
+    {
+        for(size_t id = 0; id < sim_node_count(); id++)
+        {
+            positions[id].x = config->area * sim_random() / UINT32_MAX;
+            positions[id].y = config->area * sim_random() / UINT32_MAX;
+        }
+
+        return;
+    }
+
+    FILE* file = fopen(config->positions_file, "r");
+    if(file == NULL)
+    {
+        perror(config->positions_file);
+        exit(EXIT_FAILURE);
+    }
+
+    for(size_t id = 0; id < sim_node_count(); id++)
+    {
+        if(fscanf(file, "%lf %lf", &positions[id].x, &positions[id].y) != 2)
+        {
+            fprintf(stderr, "%s: no position for node %zu\n", config->positions_file, id);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    fclose(file);
+}
+
+static double link_uniform(size_t a, size_t b, uint64_t salt)
+{
+    // a hash of the (unordered) link, so the shadowing is the same in both directions and for every frame
+    uint64_t h = (a < b ? (a << 32) | b : (b << 32) | a) ^ (sim_get_config()->seed * UINT64_C(0x9E3779B97F4A7C15)) ^ salt;
+    h ^= h >> 33;
+    h *= UINT64_C(0xff51afd7ed558ccd);
+    h ^= h >> 33;
+    h *= UINT64_C(0xc4ceb9fe1a85ec53);
+    h ^= h >> 33;
+    return (h >> 11) * (1.0 / 9007199254740992.0); // [0, 1)
+}
+
+static double path_loss(size_t a, size_t b)
+{
+    sim_config_t const* config = sim_get_config();
+    double dx = positions[a].x - positions[b].x;
+    double dy = positions[a].y - positions[b].y;
+    double distance = sqrt(dx * dx + dy * dy);
+    if(distance < 1.0)
+        distance = 1.0;
+
+    double loss = PATH_LOSS_1M + 10.0 * config->path_loss_exponent * log10(distance);
+    if(config->shadowing > 0)
+    {
+        // Box-Muller
+        double u1 = link_uniform(a, b, 1);
+        double u2 = link_uniform(a, b, 2);
+        loss += config->shadowing * sqrt(-2.0 * log(1.0 - u1)) * cos(2 * M_PI * u2);
+    }
+
+    return loss;
+}
+
+static double dbm_to_mw(double dbm)
+{
+    return pow(10.0, dbm / 10.0);
+}
+
+static double mw_to_dbm(double mw)
+{
+    return 10.0 * log10(mw);
+}
+
+static double received_power(size_t sender, int8_t eirp, size_t receiver)
+{
+    return eirp - path_loss(sender, receiver);
+}
+
+static bool is_listening(radio_t const* radio, transmission_t const* tx)
+{
+    return radio->current_state == HW_RADIO_STATE_RX
+            && radio->rx_packet_callback != NULL
+            && radio->rx_start <= tx->start
+            && radio->current_rx_cfg.syncword_class == tx->syncword_class
+            && hw_radio_channel_ids_equal(&radio->current_rx_cfg.channel_id, &tx->channel_id);
+}
+
+static double noise_floor(radio_t const* radio)
+{
+    return class_params(radio->current_rx_cfg.channel_id.channel_header.ch_class)->noise_floor;
+}
+
+static void add_interferer(medium_entry_t* entry, transmission_t const* other)
+{
+    if(entry->interferer_count == entry->interferer_capacity)
+    {
+        entry->interferer_capacity = entry->interferer_capacity ? 2 * entry->interferer_capacity : 4;
+        entry->interferers = realloc(entry->interferers, entry->interferer_capacity * sizeof(interferer_t));
+        assert(entry->interferers != NULL);
+    }
+
+    entry->interferers[entry->interferer_count++] = (interferer_t){ .node = other->sender, .eirp = other->eirp };
+}
+
+static void release_transmission(transmission_t* tx)
+{
+    // the workers release their references concurrently
+    if(__atomic_sub_fetch(&tx->refs, 1, __ATOMIC_ACQ_REL) == 0)
+        free(tx);
+}
+
+static void frame_received_isr(void* arg, uint32_t lqi)
+{
+    transmission_t* tx = (transmission_t*)arg;
+    radio_t* radio = current_radio();
+    if(is_listening(radio, tx))
+    {
+        hw_radio_packet_t* packet = radio->alloc_packet_callback(tx->data[0]);
+        if(packet != NULL)
+        {
+            memcpy(packet->data, tx->data, tx->data[0] + 1);
+            packet->rx_meta.rssi = (int16_t)lround(received_power(tx->sender, tx->eirp, sim_current_node()));
+            packet->rx_meta.lqi = lqi;
+            packet->rx_meta.rx_cfg = radio->current_rx_cfg;
+            packet->rx_meta.crc_status = HW_CRC_UNAVAILABLE;
+            packet->rx_meta.timestamp = timer_get_counter_value();
+            current_medium()->rx_frames++;
+            radio->rx_packet_callback(packet);
+        }
+    }
+
+    release_transmission(tx);
+}
+
+static void offer_frame(medium_t* medium, medium_entry_t const* entry, size_t receiver)
+{
+    transmission_t* tx = entry->tx;
+    radio_t const* radio = &radios[receiver];
+    double noise = dbm_to_mw(noise_floor(radio));
+    double signal = dbm_to_mw(received_power(tx->sender, tx->eirp, receiver));
+    double interference = 0;
+    for(uint32_t i = 0; i < entry->interferer_count; i++)
+        interference += dbm_to_mw(received_power(entry->interferers[i].node, entry->interferers[i].eirp, receiver));
+
+    if(mw_to_dbm(signal / noise) < CAPTURE_THRESHOLD)
+    {
+        medium->rx_weak++;
+        return;
+    }
+
+    double sinr = mw_to_dbm(signal / (noise + interference));
+    if(sinr < CAPTURE_THRESHOLD)
+    {
+        medium->rx_collided++;
+        return;
+    }
+
+    __atomic_add_fetch(&tx->refs, 1, __ATOMIC_RELAXED);
+    sim_schedule(sim_now(), receiver, &frame_received_isr, tx, sinr > 127 ? 127 : (uint32_t)sinr);
+}
+
+static void add_to_medium(transmission_t* tx)
+{
+    medium_t* medium = current_medium();
+    medium_entry_t* entry = calloc(1, sizeof(medium_entry_t));
+    assert(entry != NULL);
+    entry->tx = tx;
+
+    for(medium_entry_t* other = medium->ongoing; other != NULL; other = other->next)
+    {
+        if(!hw_radio_channel_ids_equal(&other->tx->channel_id, &tx->channel_id))
+            continue;
+
+        // count the overlaps once, as seen by the first worker
+        if(sim_worker_index() == 0)
+        {
+            if(other->interferer_count == 0)
+                medium->tx_overlapped++;
+            if(entry->interferer_count == 0)
+                medium->tx_overlapped++;
+        }
+
+        add_interferer(other, tx);
+        add_interferer(entry, other->tx);
+    }
+
+    entry->next = medium->ongoing;
+    medium->ongoing = entry;
+}
+
+static void tx_started(void* arg, uint32_t data)
+{
+    // executed by every worker at the start of the transmission
+    add_to_medium((transmission_t*)arg);
+}
+
+static void remove_from_medium(transmission_t* tx)
+{
+    medium_t* medium = current_medium();
+
+    // remove the transmission from the medium and hand the frame to the listening nodes of this worker
+    medium_entry_t** link = &medium->ongoing;
+    while((*link)->tx != tx)
+        link = &(*link)->next;
+    medium_entry_t* entry = *link;
+    *link = entry->next;
+
+    for(size_t id = sim_worker_index(); id < sim_node_count(); id += sim_worker_count())
+        if(id != tx->sender && radios[id].inited && is_listening(&radios[id], tx))
+            offer_frame(medium, entry, id);
+
+    free(entry->interferers);
+    free(entry);
+    release_transmission(tx);
+}
+
+static void tx_ended(void* arg, uint32_t data)
+{
+    // executed by every worker at the end of the transmission
+    remove_from_medium((transmission_t*)arg);
+}
+
+static void tx_completed_isr(void* arg, uint32_t data)
+{
+    transmission_t* tx = (transmission_t*)arg;
+    release_transmission(tx);
+
+    radio_t* radio = current_radio();
+    if(radio->current_state != HW_RADIO_STATE_TX)
+        return;
+
+    radio->current_state = HW_RADIO_STATE_IDLE;
+    if(radio->tx_packet_callback != 0)
+    {
+        radio->current_packet->tx_meta.timestamp = timer_get_counter_value();
+        radio->tx_packet_callback(radio->current_packet);
+    }
+
+    if(radio->should_rx_after_tx_completed && radio->current_state == HW_RADIO_STATE_IDLE)
+        start_rx(&radio->pending_rx_cfg);
+
+    radio->should_rx_after_tx_completed = false;
+}
+
+void sim_radio_setup()
+{
+    radios = calloc(sim_node_count(), sizeof(radio_t));
+    media = calloc(sim_worker_count(), sizeof(medium_t));
+    assert(radios != NULL && media != NULL);
+    place_nodes();
+}
+
+error_t hw_radio_init(alloc_packet_callback_t alloc_packet_cb,
+                      release_packet_callback_t release_packet_cb)
+{
+    radio_t* radio = current_radio();
+    if(alloc_packet_cb == NULL || release_packet_cb == NULL)
+        return EINVAL;
+    if(radio->inited)
+        return EALREADY;
+
+    radio->alloc_packet_callback = alloc_packet_cb;
+    radio->release_packet_callback = release_packet_cb;
+    radio->current_state = HW_RADIO_STATE_IDLE;
+    radio->inited = true;
+    return SUCCESS;
+}
+static void rssi_valid_isr(void* arg, uint32_t generation)
+{
+    radio_t* radio = current_radio();
+    if(generation != radio->rssi_generation || radio->current_state != HW_RADIO_STATE_RX)
+        return;
+
+    if(radio->rssi_valid_callback != 0)
+        radio->rssi_valid_callback(hw_radio_get_rssi());
+}
+
+static void start_rx(hw_rx_cfg_t const* rx_cfg)
+{
+    radio_t* radio = current_radio();
+    // (re)configuring the radio restarts the reception, unless nothing changes
+    if(radio->current_state != HW_RADIO_STATE_RX
+            || radio->current_rx_cfg.syncword_class != rx_cfg->syncword_class
+            || !hw_radio_channel_ids_equal(&radio->current_rx_cfg.channel_id, &rx_cfg->channel_id))
+        radio->rx_start = sim_now();
+
+    radio->current_state = HW_RADIO_STATE_RX;
+    radio->current_rx_cfg = *rx_cfg;
+
+    radio->rssi_generation++;
+    if(radio->rssi_valid_callback != 0)
+        sim_schedule(sim_now() + RSSI_VALID_DELAY, sim_current_node(), &rssi_valid_isr, NULL, radio->rssi_generation);
+}
+
+error_t hw_radio_set_rx(hw_rx_cfg_t const* rx_cfg, rx_packet_callback_t rx_cb, rssi_valid_callback_t rssi_valid_cb)
+{
+    radio_t* radio = current_radio();
+    if(!radio->inited)
+        return EOFF;
+
+    radio->rx_packet_callback = rx_cb;
+    radio->rssi_valid_callback = rssi_valid_cb;
+
+    // if we are currently transmitting wait until TX completed before entering RX
+    if(radio->current_state == HW_RADIO_STATE_TX)
+    {
+        radio->should_rx_after_tx_completed = true;
+        radio->pending_rx_cfg = *rx_cfg;
+        return SUCCESS;
+    }
+
+    start_rx(rx_cfg);
+    return SUCCESS;
+}
+
+bool hw_radio_is_rx()
+{
+    radio_t* radio = current_radio();
+    return radio->current_state == HW_RADIO_STATE_RX || radio->should_rx_after_tx_completed;
+}
+
+error_t hw_radio_send_packet(hw_radio_packet_t* packet, tx_packet_callback_t tx_cb)
+{
+    radio_t* radio = current_radio();
+    if(!radio->inited)
+        return EOFF;
+    if(radio->current_state == HW_RADIO_STATE_TX)
+        return EBUSY;
+
+    radio->tx_packet_callback = tx_cb;
+    radio->should_rx_after_tx_completed = false;
+    radio->current_state = HW_RADIO_STATE_TX;
+    radio->current_packet = packet;
+
+    transmission_t* tx = malloc(sizeof(transmission_t));
+    assert(tx != NULL);
+    tx->sender = sim_current_node();
+    tx->eirp = packet->tx_meta.tx_cfg.eirp;
+    tx->channel_id = packet->tx_meta.tx_cfg.channel_id;
+    tx->syncword_class = packet->tx_meta.tx_cfg.syncword_class;
+    tx->start = sim_now() + TX_TURNAROUND;
+    tx->end = tx->start + tx_duration(packet);
+    tx->refs = 1 + sim_worker_count();
+    memcpy(tx->data, packet->data, packet->length + 1);
+
+    medium_t* medium = current_medium();
+    medium->tx_frames++;
+    medium->airtime += tx->end - tx->start;
+
+    // the turnaround lets every worker learn about the transmission before it starts
+    sim_schedule(tx->end, tx->sender, &tx_completed_isr, tx, 0);
+    sim_broadcast(tx->start, &tx_started, tx, 0);
+    sim_broadcast(tx->end, &tx_ended, tx, 0);
+    return SUCCESS;
+}
+
+bool hw_radio_tx_busy()
+{
+    return current_radio()->current_state == HW_RADIO_STATE_TX;
+}
+
+bool hw_radio_rx_busy()
+{
+    // a frame is being received when a transmission we can detect started on our channel while we were listening
+    radio_t* radio = current_radio();
+    if(radio->current_state != HW_RADIO_STATE_RX)
+        return false;
+
+    for(medium_entry_t* entry = current_medium()->ongoing; entry != NULL; entry = entry->next)
+        if(is_listening(radio, entry->tx)
+                && received_power(entry->tx->sender, entry->tx->eirp, sim_current_node()) - noise_floor(radio) >= CAPTURE_THRESHOLD)
+            return true;
+
+    return false;
+}
+
+bool hw_radio_rssi_valid()
+{
+    radio_t* radio = current_radio();
+    return radio->current_state == HW_RADIO_STATE_RX && sim_now() >= radio->rx_start + RSSI_VALID_DELAY;
+}
+
+int16_t hw_radio_get_rssi()
+{
+    if(!hw_radio_rssi_valid())
+        return HW_RSSI_INVALID;
+
+    // the total power on the channel: the noise floor and all ongoing transmissions
+    radio_t* radio = current_radio();
+    double power = dbm_to_mw(noise_floor(radio));
+    for(medium_entry_t* entry = current_medium()->ongoing; entry != NULL; entry = entry->next)
+    {
+        transmission_t const* tx = entry->tx;
+        if(tx->sender != sim_current_node() && hw_radio_channel_ids_equal(&radio->current_rx_cfg.channel_id, &tx->channel_id))
+            power += dbm_to_mw(received_power(tx->sender, tx->eirp, sim_current_node()));
+    }
+
+    return (int16_t)lround(mw_to_dbm(power));
+}
+
+error_t hw_radio_set_idle()
+{
+    radio_t* radio = current_radio();
+    if(!radio->inited)
+        return EOFF;
+
+    // if we are currently transmitting wait until TX completed before entering IDLE
+    if(radio->current_state == HW_RADIO_STATE_TX)
+    {
+        radio->should_rx_after_tx_completed = false;
+        radio->tx_packet_callback = NULL;
+        return SUCCESS;
+    }
+
+    if(radio->current_state == HW_RADIO_STATE_IDLE)
+        return EALREADY;
+
+    radio->current_state = HW_RADIO_STATE_IDLE;
+    return SUCCESS;
+}
+
+bool hw_radio_is_idle()
+{
+    radio_t* radio = current_radio();
+    return radio->current_state == HW_RADIO_STATE_IDLE && !radio->should_rx_after_tx_completed;
+}
+
+void sim_radio_report(FILE* out, uint64_t duration)
+{
+    medium_t stats = { 0 };
+    for(size_t i = 0; i < sim_worker_count(); i++)
+    {
+        stats.tx_frames += media[i].tx_frames;
+        stats.tx_overlapped += media[i].tx_overlapped;
+        stats.airtime += media[i].airtime;
+        stats.rx_frames += media[i].rx_frames;
+        stats.rx_collided += media[i].rx_collided;
+        stats.rx_weak += media[i].rx_weak;
+    }
+
+    double seconds = duration / (double)SIM_NSEC_PER_SEC;
+    uint64_t rx_decodable = stats.rx_frames + stats.rx_collided;
+    fprintf(out, "medium: %llu frames transmitted, %llu overlapped another transmission, airtime %.1f%%\n",
+            (unsigned long long)stats.tx_frames, (unsigned long long)stats.tx_overlapped,
+            duration ? 100.0 * stats.airtime / duration : 0);
+    fprintf(out, "medium: %llu frames received (goodput %.1f frames/s), %llu lost in collisions (%.1f%%), %llu below sensitivity\n",
+            (unsigned long long)stats.rx_frames, seconds > 0 ? stats.rx_frames / seconds : 0,
+            (unsigned long long)stats.rx_collided, rx_decodable ? 100.0 * stats.rx_collided / rx_decodable : 0,
+            (unsigned long long)stats.rx_weak);
+}
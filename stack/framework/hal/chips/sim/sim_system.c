@@ -0,0 +1,68 @@
+/* * OSS-7 - An opensource implementation of the DASH7 Alliance Protocol for ultra
+ * lowpower wireless sensor communication
+ *
+ * Copyright 2015 University of Antwerp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*! \file sim_system.c
+ *
+ */
+
+#include <stdio.h>
+
+#include "hwsystem.h"
+#include "sim_kernel.h"
+
+void hw_enter_lowpower_mode(uint8_t mode)
+{
+    // sleep until the next event for this node, the other nodes run in the meantime
+    (void)mode;
+    sim_idle();
+}
+
+uint32_t hw_get_lowpower_mode_wakeup_latency(uint8_t mode)
+{
+    (void)mode;
+    return 0;
+}
+
+uint64_t hw_get_unique_id()
+{
+    // node n has UID n + 1, which keeps the ids in the output easy to map on the nodes
+    return sim_current_node() + 1;
+}
+
+void hw_busy_wait(int16_t microseconds)
+{
+    if(microseconds > 0)
+        sim_wait_until(sim_now() + microseconds * SIM_NSEC_PER_USEC);
+}
+
+void hw_reset()
+{
+    // the node globals of a single node can not be restored to their initial values: stop the node instead
+    fprintf(stderr, "node %zu: reset at %.6f s, node halted\n", sim_current_node(), sim_now() / (double)SIM_NSEC_PER_SEC);
+    sim_halt();
+}
+
+float hw_get_internal_temperature()
+{
+    return 25.0f;
+}
+
+uint32_t hw_get_battery(void)
+{
+    return 3000;
+}
@@ -0,0 +1,214 @@
+/* * OSS-7 - An opensource implementation of the DASH7 Alliance Protocol for ultra
+ * lowpower wireless sensor communication
+ *
+ * Copyright 2015 University of Antwerp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*! \file sim_timer.c
+ *
+ *  A free running 16-bit hardware timer per node, counting in virtual time.
+ *
+ *  Like the RTC of an MCU the timer has a compare and an overflow interrupt: a single event
+ *  is scheduled for whichever of both comes first. Rescheduling does not remove the event
+ *  from the queue, instead every event carries a generation number and stale ones are ignored.
+ *  The counter starts when the node initialises the timer, so the clocks of the nodes are not
+ *  aligned. Events are only handled while a node is suspended, so unlike the other timer
+ *  drivers this one does not need atomic sections.
+ *
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "hwtimer.h"
+#include "sim_kernel.h"
+#include "ng.h"
+#include "debug.h"
+
+#define COUNTER_BITS (8*sizeof(hwtimer_tick_t))
+
+static timer_callback_t NGDEF(_compare_f);
+#define compare_f NG(_compare_f)
+
+static timer_callback_t NGDEF(_overflow_f);
+#define overflow_f NG(_overflow_f)
+
+static bool NGDEF(_timer_inited);
+#define timer_inited NG(_timer_inited)
+
+static uint32_t NGDEF(_ticks_per_sec);
+#define ticks_per_sec NG(_ticks_per_sec)
+
+static uint64_t NGDEF(_epoch);                 // the virtual time of the last counter reset
+#define epoch NG(_epoch)
+
+static uint64_t NGDEF(_overflows_handled);     // the number of overflow interrupts that were delivered
+#define overflows_handled NG(_overflows_handled)
+
+static bool NGDEF(_compare_enabled);
+#define compare_enabled NG(_compare_enabled)
+
+static uint64_t NGDEF(_compare_tick);          // the absolute tick (since epoch) at which the compare interrupt fires
+#define compare_tick NG(_compare_tick)
+
+static uint32_t NGDEF(_alarm_generation);
+#define alarm_generation NG(_alarm_generation)
+
+static uint64_t current_tick()
+{
+    uint64_t elapsed = sim_now() - epoch;
+    return (elapsed / SIM_NSEC_PER_SEC) * ticks_per_sec + ((elapsed % SIM_NSEC_PER_SEC) * ticks_per_sec) / SIM_NSEC_PER_SEC;
+}
+
+static uint64_t tick_to_time(uint64_t tick)
+{
+    //round up, so current_tick() >= tick once the alarm expires
+    return epoch + (tick / ticks_per_sec) * SIM_NSEC_PER_SEC
+            + ((tick % ticks_per_sec) * SIM_NSEC_PER_SEC + ticks_per_sec - 1) / ticks_per_sec;
+}
+
+static bool overflow_pending()
+{
+    return (current_tick() >> COUNTER_BITS) > overflows_handled;
+}
+
+static bool compare_pending()
+{
+    return compare_enabled && current_tick() >= compare_tick;
+}
+
+static void timer_isr(void* arg, uint32_t generation);
+
+static void arm_alarm()
+{
+    uint64_t next_tick = (overflows_handled + 1) << COUNTER_BITS;
+    if(compare_enabled && compare_tick < next_tick)
+        next_tick = compare_tick;
+
+    uint64_t time = tick_to_time(next_tick);
+    if(time < sim_now())
+        time = sim_now();
+
+    alarm_generation++;
+    sim_schedule(time, sim_current_node(), &timer_isr, NULL, alarm_generation);
+}
+
+static void timer_isr(void* arg, uint32_t generation)
+{
+    if(generation != alarm_generation)
+        return; // the alarm was rescheduled in the meantime
+
+    while(overflow_pending())
+    {
+        overflows_handled++;
+        if(overflow_f != 0x0)
+            overflow_f();
+    }
+
+    if(compare_pending())
+    {
+        compare_enabled = false;
+        if(compare_f != 0x0)
+            compare_f();
+    }
+
+    arm_alarm();
+}
+
+error_t hw_timer_init(hwtimer_id_t timer_id, uint8_t frequency, timer_callback_t compare_callback, timer_callback_t overflow_callback)
+{
+    if(timer_id >= HWTIMER_NUM)
+        return ESIZE;
+    if(timer_inited)
+        return EALREADY;
+    if(frequency != HWTIMER_FREQ_1MS && frequency != HWTIMER_FREQ_32K)
+        return EINVAL;
+
+    compare_f = compare_callback;
+    overflow_f = overflow_callback;
+    ticks_per_sec = (frequency == HWTIMER_FREQ_1MS) ? HWTIMER_TICKS_1MS : HWTIMER_TICKS_32K;
+    epoch = sim_now();
+    overflows_handled = 0;
+    compare_enabled = false;
+    timer_inited = true;
+    arm_alarm();
+    return SUCCESS;
+}
+
+hwtimer_tick_t hw_timer_getvalue(hwtimer_id_t timer_id)
+{
+    if(timer_id >= HWTIMER_NUM || (!timer_inited))
+        return 0;
+
+    return (hwtimer_tick_t)current_tick();
+}
+
+error_t hw_timer_schedule(hwtimer_id_t timer_id, hwtimer_tick_t tick)
+{
+    if(timer_id >= HWTIMER_NUM)
+        return ESIZE;
+    if(!timer_inited)
+        return EOFF;
+
+    uint64_t now = current_tick();
+    hwtimer_tick_t delay = tick - (hwtimer_tick_t)now;
+    //like a hardware compare register: a match on the current value only occurs after a full wrap
+    compare_tick = now + (delay == 0 ? (UINT64_C(1) << COUNTER_BITS) : delay);
+    compare_enabled = true;
+    arm_alarm();
+    return SUCCESS;
+}
+
+error_t hw_timer_cancel(hwtimer_id_t timer_id)
+{
+    if(timer_id >= HWTIMER_NUM)
+        return ESIZE;
+    if(!timer_inited)
+        return EOFF;
+
+    compare_enabled = false;
+    arm_alarm();
+    return SUCCESS;
+}
+
+error_t hw_timer_counter_reset(hwtimer_id_t timer_id)
+{
+    if(timer_id >= HWTIMER_NUM)
+        return ESIZE;
+    if(!timer_inited)
+        return EOFF;
+
+    epoch = sim_now();
+    overflows_handled = 0;
+    compare_enabled = false;
+    arm_alarm();
+    return SUCCESS;
+}
+
+bool hw_timer_is_overflow_pending(hwtimer_id_t timer_id)
+{
+    if(timer_id >= HWTIMER_NUM || (!timer_inited))
+        return false;
+
+    return overflow_pending();
+}
+
+bool hw_timer_is_interrupt_pending(hwtimer_id_t timer_id)
+{
+    if(timer_id >= HWTIMER_NUM || (!timer_inited))
+        return false;
+
+    return compare_pending();
+}
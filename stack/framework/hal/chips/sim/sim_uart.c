@@ -0,0 +1,92 @@
+/* * OSS-7 - An opensource implementation of the DASH7 Alliance Protocol for ultra
+ * lowpower wireless sensor communication
+ *
+ * Copyright 2015 University of Antwerp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*! \file sim_uart.c
+ *
+ *  Every node has a single UART, which is used by the console. The output of one node
+ *  (selected with the -u option of the simulator) is written to stdout, the output of
+ *  the other nodes is dropped. There is no input.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "hwuart.h"
+#include "errors.h"
+#include "sim_kernel.h"
+#include "ng.h"
+
+struct uart_handle {
+  size_t node;
+  uint32_t baudrate;
+  bool enabled;
+  uart_rx_inthandler_t handler;
+};
+
+static uart_handle_t NGDEF(_handle);
+#define handle NG(_handle)
+
+uart_handle_t* uart_init(uint8_t idx, uint32_t baudrate, uint8_t pins) {
+  // there is only one UART and no pins to route
+  (void)idx;
+  (void)pins;
+  handle.node = sim_current_node();
+  handle.baudrate = baudrate;
+  return &handle;
+}
+
+bool uart_enable(uart_handle_t* uart) {
+  uart->enabled = true;
+  return true;
+}
+
+bool uart_disable(uart_handle_t* uart) {
+  uart->enabled = false;
+  return true;
+}
+
+void uart_set_rx_interrupt_callback(uart_handle_t* uart,
+                                    uart_rx_inthandler_t rx_handler)
+{
+  uart->handler = rx_handler;
+}
+
+void uart_send_byte(uart_handle_t* uart, uint8_t data) {
+  uart_send_bytes(uart, &data, 1);
+}
+
+void uart_send_bytes(uart_handle_t* uart, void const *data, size_t length) {
+  if(!uart->enabled || uart->node != sim_console_node())
+    return;
+
+  fwrite(data, 1, length, stdout);
+  fflush(stdout);
+}
+
+void uart_send_string(uart_handle_t* uart, const char *string) {
+  uart_send_bytes(uart, string, strnlen(string, 100));
+}
+
+error_t uart_rx_interrupt_enable(uart_handle_t* uart) {
+  if(uart->handler == NULL) { return EOFF; }
+  // nothing is ever received
+  return SUCCESS;
+}
+
+void uart_rx_interrupt_disable(uart_handle_t* uart) {
+}
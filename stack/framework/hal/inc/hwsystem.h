@@ -53,6 +53,28 @@
  */
 __LINK_C void hw_enter_lowpower_mode(uint8_t mode);
 
+/*! \brief Returned by hw_get_lowpower_mode_wakeup_latency() for a mode in which the
+ * timer used by the framework does not run: the mode can only be used when no timer event is pending.
+ */
+#define HW_LOWPOWER_MODE_NO_TIMER (UINT32_MAX - 1)
+
+/*! \brief Returned by hw_get_lowpower_mode_wakeup_latency() for a mode which is not supported
+ * or which should never be selected automatically.
+ */
+#define HW_LOWPOWER_MODE_UNSUPPORTED UINT32_MAX
+
+/*! \brief Get the wake-up latency of a low power mode
+ *
+ * The wake-up latency is the time between the interrupt which wakes up the MCU and the moment
+ * the MCU runs at full speed again. The scheduler uses this to select the deepest low power mode
+ * (not deeper than the mode set with sched_set_low_power_mode()) from which the MCU can wake up
+ * in time for the next timer event.
+ *
+ * \param mode	The low power mode, as passed to hw_enter_lowpower_mode()
+ * \return uint32_t	The wake-up latency in microseconds, HW_LOWPOWER_MODE_NO_TIMER or HW_LOWPOWER_MODE_UNSUPPORTED
+ */
+__LINK_C uint32_t hw_get_lowpower_mode_wakeup_latency(uint8_t mode);
+
 /*! \brief Get a 64-bit identifier that is unique to the device on which this function is called.
  *
  * The exact manner in which this ID is generated depends on the specific platform. In general however,
@@ -0,0 +1,47 @@
+/* * OSS-7 - An opensource implementation of the DASH7 Alliance Protocol for ultra
+ * lowpower wireless sensor communication
+ *
+ * Copyright 2015 University of Antwerp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "scheduler.h"
+#include "bootstrap.h"
+#include "hwleds.h"
+#include "hwwatchdog.h"
+#include "posix_mcu.h"
+
+void __platform_init()
+{
+    __led_init();
+    __watchdog_init();
+}
+
+void __platform_post_framework_init()
+{
+}
+
+int main(int argc, char** argv)
+{
+    //initialise the 'chip' first: start_atomic() depends on it
+    __posix_mcu_init(argc, argv);
+    //initialise the platform itself
+    __platform_init();
+    //do not initialise the scheduler, this is done by __framework_bootstrap()
+    __framework_bootstrap();
+    //initialise platform functionality that depends on the framework
+    __platform_post_framework_init();
+    scheduler_run();
+    return 0;
+}
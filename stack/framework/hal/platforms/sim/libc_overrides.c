@@ -0,0 +1,35 @@
+/* * OSS-7 - An opensource implementation of the DASH7 Alliance Protocol for ultra
+ * lowpower wireless sensor communication
+ *
+ * Copyright 2015 University of Antwerp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "debug.h"
+#include "sim_kernel.h"
+
+//debug.h maps assert() on __assert_func (provided by newlib on the MCU platforms)
+void __assert_func( const char *file, int line, const char *func, const char *failedexpr)
+{
+    // a failed assert is a bug in the stack or the simulator, not a reason to reset one node
+    fflush(stdout);
+    fprintf(stderr, "assertion \"%s\" failed: file \"%s\", line %d%s%s (node %zu, time %.6f s)\n",
+            failedexpr, file, line, func ? ", function: " : "", func ? func : "",
+            sim_current_node(), sim_now() / (double)SIM_NSEC_PER_SEC);
+    //abort() so a core dump / debugger shows where it happened
+    abort();
+}
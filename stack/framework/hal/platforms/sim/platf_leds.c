@@ -0,0 +1,75 @@
+/* * OSS-7 - An opensource implementation of the DASH7 Alliance Protocol for ultra
+ * lowpower wireless sensor communication
+ *
+ * Copyright 2015 University of Antwerp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*! \file platf_leds.c
+ *
+ *  Every simulated node has its own leds. State changes are traced on stderr, together
+ *  with the node and the virtual time, when the OSS7_LED_TRACE environment variable is set.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "hwleds.h"
+#include "platform.h"
+#include "sim_kernel.h"
+#include "ng.h"
+
+#if HW_NUM_LEDS != 2
+	#error HW_NUM_LEDS does not match the expected value. Update platform.h or platf_leds.c
+#endif
+
+static bool NGDEF(_leds)[ HW_NUM_LEDS ];
+#define leds NG(_leds)
+
+static bool trace = false;
+
+static void set_led(uint8_t led_nr, bool on)
+{
+    if(led_nr >= HW_NUM_LEDS)
+        return;
+
+    leds[led_nr] = on;
+    if(trace)
+        fprintf(stderr, "%.6f node %zu led%d: %s\n", sim_now() / (double)SIM_NSEC_PER_SEC,
+                sim_current_node(), led_nr, on ? "on" : "off");
+}
+
+void __led_init()
+{
+    trace = getenv("OSS7_LED_TRACE") != NULL;
+    for(int i = 0; i < HW_NUM_LEDS; i++)
+        leds[i] = false;
+}
+
+void led_on(uint8_t led_nr)
+{
+    set_led(led_nr, true);
+}
+
+void led_off(uint8_t led_nr)
+{
+    set_led(led_nr, false);
+}
+
+void led_toggle(uint8_t led_nr)
+{
+    if(led_nr < HW_NUM_LEDS)
+        set_led(led_nr, !leds[led_nr]);
+}
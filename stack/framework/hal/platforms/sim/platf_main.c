@@ -0,0 +1,54 @@
+/* * OSS-7 - An opensource implementation of the DASH7 Alliance Protocol for ultra
+ * lowpower wireless sensor communication
+ *
+ * Copyright 2015 University of Antwerp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+
+#include "scheduler.h"
+#include "bootstrap.h"
+#include "hwleds.h"
+#include "hwwatchdog.h"
+#include "sim_kernel.h"
+
+void __platform_init()
+{
+    __led_init();
+    __watchdog_init();
+}
+
+void __platform_post_framework_init()
+{
+}
+
+static void node_main()
+{
+    //every node boots like a platform on its own
+    __platform_init();
+    //do not initialise the scheduler, this is done by __framework_bootstrap()
+    __framework_bootstrap();
+    //initialise platform functionality that depends on the framework
+    __platform_post_framework_init();
+    scheduler_run();
+}
+
+int main(int argc, char** argv)
+{
+    sim_init(argc, argv);
+    sim_run(&node_main);
+    sim_report(stderr);
+    return 0;
+}
@@ -25,6 +25,33 @@
 
 #include <stdint.h>
 
-uint16_t crc_calculate(uint8_t* data, uint8_t length);
+/*! \brief Start the calculation of a CRC
+ *
+ * The CRC is calculated incrementally by passing the data to crc_update(), in one or more parts,
+ * and passing the result to crc_final(). All state is in the returned value, so several CRCs can
+ * be calculated at the same time.
+ *
+ * \return uint16_t	The initial CRC state
+ */
+uint16_t crc_init();
+
+/*! \brief Add data to a CRC calculation
+ *
+ * \param crc		The CRC state, as returned by crc_init() or a previous crc_update()
+ * \param data		The data
+ * \param length	The number of bytes of data
+ * \return uint16_t	The updated CRC state
+ */
+uint16_t crc_update(uint16_t crc, const uint8_t* data, uint16_t length);
+
+/*! \brief Finish a CRC calculation
+ *
+ * \param crc		The CRC state, as returned by crc_update()
+ * \return uint16_t	The CRC of all data passed to crc_update()
+ */
+uint16_t crc_final(uint16_t crc);
+
+/*! \brief Calculate the CRC of a buffer, see crc_init() */
+uint16_t crc_calculate(uint8_t* data, uint16_t length);
 
 #endif /* CRC_H_ */
@@ -30,25 +30,168 @@ extern "C" {
 #include <stdbool.h>
 #include <stdint.h>
 
+/*! \brief The number of trellis steps a decoder keeps the decisions of
+ *
+ * A decoded byte (8 steps) is decided by tracing back from the state with the lowest cost,
+ * after the decisions for the next byte are known.
+ */
+#define FEC_DECODER_TRACEBACK_STEPS 16
+
+/*! \brief The largest soft bit value, see fec_decoder_decode_soft()
+ *
+ * Soft bits are 3 bit confidence values: 0 is a certain 0, FEC_SOFT_BIT_MAX a certain 1 and the values in between
+ * are less certain, for example the demodulator output quantized to 8 levels.
+ */
+#define FEC_SOFT_BIT_MAX 7
+
+/*! \brief The state of a Viterbi decoder, see fec_decoder_init() */
 typedef struct {
-	uint8_t cost;
-	uint16_t path;
-} VITERBIPATH;
+	uint16_t cost[8]; /**< The path metric of each state of the trellis */
+	uint8_t decisions[FEC_DECODER_TRACEBACK_STEPS]; /**< The survivor paths: bit k is set when state k was reached from state (k >> 1) + 4 instead of k >> 1, for each of the last steps */
+	uint16_t steps; /**< The number of trellis steps taken */
+	uint8_t block[4]; /**< The encoded bytes of an incomplete block, which are decoded together with the next chunk */
+	uint8_t block_length; /**< The number of bytes in block */
+} fec_decoder_t;
+
+/*! \brief The number of encoded bytes from which the length of a packet is known, see fec_rx_start() */
+#define FEC_RX_HEADER_LENGTH 4
 
+/*! \brief The state of a packet which is decoded in place while it is received, see fec_rx_start() */
 typedef struct {
-	uint8_t path_size;
-	VITERBIPATH* old;
-	VITERBIPATH* new;
-	VITERBIPATH states1[8];
-	VITERBIPATH states2[8];
-} VITERBISTATE;
+	fec_decoder_t decoder; /**< The decoder of the packet */
+	uint16_t packet_length; /**< The number of encoded bytes of the packet */
+	uint16_t input_length; /**< The number of encoded bytes which are decoded */
+	uint16_t output_length; /**< The number of decoded bytes */
+} fec_rx_t;
 
-//void print_array(uint8_t* buffer, uint8_t length);
+/*! \brief The position in the PN9 data whitening sequence, see fec_pn9_init() */
+typedef uint16_t fec_pn9_t;
 
+/*! \brief Encode data in place
+ *
+ * \param data		The data, the buffer should be large enough for the encoded data (see fec_calculated_decoded_length())
+ * \param nbytes	The number of bytes of data
+ * \return uint16_t	The number of encoded bytes
+ */
 uint16_t fec_encode(uint8_t *data, uint16_t nbytes);
-uint8_t fec_decode_packet(uint8_t* data, uint8_t packet_length, uint8_t output_length);
+
+/*! \brief Decode a packet in place
+ *
+ * \param data		The encoded data, which is replaced by the decoded data
+ * \param packet_length	The number of encoded bytes, a multiple of 4
+ * \param output_length	The size of the buffer, at least packet_length
+ * \return uint16_t	The number of decoded bytes (packet_length / 2), or 0 when decoding failed
+ */
+uint16_t fec_decode_packet(uint8_t* data, uint16_t packet_length, uint16_t output_length);
+
+/*! \brief Decode a packet given as soft bits
+ *
+ * \param soft_bits	The soft bits of the encoded data, see fec_decoder_decode_soft()
+ * \param packet_length	The number of encoded bytes, a multiple of 4
+ * \param output	The decoded data, packet_length / 2 bytes
+ * \return uint16_t	The number of decoded bytes, or 0 when decoding failed
+ */
+uint16_t fec_decode_packet_soft(const uint8_t* soft_bits, uint16_t packet_length, uint8_t* output);
+
+/*! \brief The length of the encoded data for a given packet length */
 uint16_t fec_calculated_decoded_length(uint8_t packet_length);
 
+/*! \brief Initialise a decoder to decode a new packet
+ *
+ * All decoding state is kept in the decoder, so several packets can be decoded at the same time.
+ */
+void fec_decoder_init(fec_decoder_t* decoder);
+
+/*! \brief Decode the next chunk of a packet
+ *
+ * The chunks can have any length, for example the number of bytes read from the radio FIFO, the decoder keeps
+ * the bytes of an incomplete block of 4 until the next chunk. A byte is only output when the next byte is
+ * decoded as well, the last byte is output by fec_decoder_finish().
+ * The output may overlap the input, as long as it does not start behind it.
+ *
+ * \param decoder	The decoder
+ * \param input		The encoded data
+ * \param length	The number of encoded bytes
+ * \param output	The decoded bytes are written here, up to (length + 3) / 2 bytes
+ * \return uint16_t	The number of decoded bytes written to output
+ */
+uint16_t fec_decoder_decode(fec_decoder_t* decoder, uint8_t* input, uint16_t length, uint8_t* output);
+
+/*! \brief Decode the next chunk of a packet given as soft bits
+ *
+ * Same as fec_decoder_decode(), but the encoded data is given as one soft bit (0 to FEC_SOFT_BIT_MAX) per encoded bit,
+ * starting from the MSB of the first encoded byte. Using soft decisions adds about 2 dB of coding gain.
+ * The chunks should contain whole blocks of 4 encoded bytes.
+ *
+ * \param decoder	The decoder
+ * \param soft_bits	The soft bits of the encoded data
+ * \param length	The number of soft bits, a multiple of 32
+ * \param output	The decoded bytes are written here, up to length / 16 bytes
+ * \return uint16_t	The number of decoded bytes written to output
+ */
+uint16_t fec_decoder_decode_soft(fec_decoder_t* decoder, const uint8_t* soft_bits, uint16_t length, uint8_t* output);
+
+/*! \brief Output the last decoded byte of a packet
+ *
+ * \param decoder	The decoder
+ * \param output	The last byte is written here
+ * \return uint16_t	The number of decoded bytes written to output
+ */
+uint16_t fec_decoder_finish(fec_decoder_t* decoder, uint8_t* output);
+
+/*! \brief Start decoding a packet while it is received
+ *
+ * Radio drivers receive an encoded packet in chunks, as they read the radio FIFO. The first FEC_RX_HEADER_LENGTH
+ * bytes are decoded in place to learn the length of the packet, which is needed to allocate the packet. The header
+ * is then copied to the start of the packet, behind which the next chunks are read and passed to fec_rx_decode().
+ *
+ * \param rx		The state of the packet
+ * \param header	The first FEC_RX_HEADER_LENGTH encoded bytes, the first byte is replaced by the decoded length byte
+ * \return uint16_t	The number of encoded bytes of the packet
+ */
+uint16_t fec_rx_start(fec_rx_t* rx, uint8_t* header);
+
+/*! \brief Decode the bytes of a packet received since the previous call, in place
+ *
+ * Bytes received beyond the length of the packet are ignored.
+ *
+ * \param rx		The state of the packet
+ * \param data		The packet, starting with the header given to fec_rx_start()
+ * \param received_length	The number of bytes received in data, including the header
+ */
+void fec_rx_decode(fec_rx_t* rx, uint8_t* data, uint16_t received_length);
+
+/*! \brief Output the last decoded byte of a packet, once all its bytes are passed to fec_rx_decode()
+ *
+ * \param rx		The state of the packet
+ * \param data		The packet
+ * \return uint16_t	The number of decoded bytes at the start of data
+ */
+uint16_t fec_rx_finish(fec_rx_t* rx, uint8_t* data);
+
+/*! \brief Start a new PN9 data whitening sequence */
+void fec_pn9_init(fec_pn9_t* pn9);
+
+/*! \brief Whiten or dewhiten the next chunk of data in place
+ *
+ * The chunks can have any length, the sequence continues where the previous chunk ended.
+ *
+ * \param pn9		The state of the sequence
+ * \param data		The data
+ * \param length	The number of bytes of data
+ */
+void fec_pn9_apply(fec_pn9_t* pn9, uint8_t* data, uint16_t length);
+
+/*! \brief Interleave a block of 16 symbols
+ *
+ * Byte b of symbols contains the 4 symbols b * 4 to b * 4 + 3, starting from bits 0 and 1.
+ * Symbol m of byte b is moved to symbol b of byte m, so interleaving twice gives the original block.
+ *
+ * \param symbols	The block of symbols
+ * \return uint32_t	The interleaved block
+ */
+uint32_t fec_interleave(uint32_t symbols);
+
 #ifdef __cplusplus
 }
 #endif
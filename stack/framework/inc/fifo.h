@@ -96,6 +96,42 @@ error_t fifo_peek(fifo_t* fifo, uint8_t* buffer, uint16_t offset, uint16_t len);
  */
 error_t fifo_pop(fifo_t* fifo, uint8_t* buffer, uint16_t len);
 
+/**
+ * @brief Get the contiguous region at the tail of the FIFO, which can be written in place.
+ * The written bytes are added to the FIFO by fifo_commit(). The region can be smaller than the free space
+ * when the free space wraps around the end of the buffer, in that case the rest can be reserved after committing.
+ * @param fifo      Pointer to the fifo object
+ * @param data      Set to the start of the writable region
+ * @returns The number of bytes which can be written at data (0 when the FIFO is full)
+ */
+uint16_t fifo_reserve(fifo_t* fifo, uint8_t** data);
+
+/**
+ * @brief Add bytes written in the region returned by fifo_reserve() to the FIFO
+ * @param fifo      Pointer to the fifo object
+ * @param len       Number of bytes written
+ * @returns SUCCESS or ESIZE when len is larger than the reserved region
+ */
+error_t fifo_commit(fifo_t* fifo, uint16_t len);
+
+/**
+ * @brief Get the contiguous region at the head of the FIFO, which can be read in place without popping.
+ * The region can be smaller than the FIFO size when the data wraps around the end of the buffer, the rest can
+ * be read after dropping the region with fifo_skip().
+ * @param fifo      Pointer to the fifo object
+ * @param data      Set to the start of the readable region
+ * @returns The number of bytes which can be read at data (0 when the FIFO is empty)
+ */
+uint16_t fifo_peek_contiguous(fifo_t* fifo, uint8_t** data);
+
+/**
+ * @brief Pop bytes from the FIFO without copying them
+ * @param fifo      Pointer to the fifo object
+ * @param len       number of bytes to drop
+ * @returns SUCCESS or ESIZE if len > current size
+ */
+error_t fifo_skip(fifo_t* fifo, uint16_t len);
+
 /**
  * @brief Clears the FIFO
 * @param fifo      Pointer to the fifo object
@@ -109,6 +145,13 @@ void fifo_clear(fifo_t* fifo);
  */
 uint16_t fifo_get_size(fifo_t* fifo);
 
+/**
+ * @brief Returns the number of bytes which can still be put in the FIFO
+ * @param fifo      Pointer to the fifo object
+ * @return Number of bytes which can be put in the FIFO
+ */
+uint16_t fifo_get_free_space(fifo_t* fifo);
+
 /**
  * @brief Returns if the FIFO is completely full or if there is still space left
  * @param fifo      Pointer to the fifo object
@@ -44,6 +44,8 @@
 #include "framework_defs.h"
 #include "types.h"
 #include "hwradio.h"
+#include "scheduler.h"
+#include "timer.h"
 
 /*! \brief The source in the stack from which the log originates  */
 typedef enum
@@ -82,11 +84,23 @@ __LINK_C void log_print_raw_phy_packet(hw_radio_packet_t* packet, bool is_tx);
 /*! \brief Log raw data */
 __LINK_C void log_print_data(uint8_t* message, uint32_t length);
 
+#ifdef FRAMEWORK_SCHEDULER_INSTRUMENTATION
+/*! \brief Log the execution statistics of a task, see sched_get_task_stats() */
+__LINK_C void log_print_task_stats(task_handle_t handle, sched_task_stats_t* stats);
+#endif
+
+#ifdef FRAMEWORK_TIMER_INSTRUMENTATION
+/*! \brief Log the accuracy statistics of the timer, see timer_get_stats() */
+__LINK_C void log_print_timer_stats(timer_stats_t* stats);
+#endif
+
 #else
     #define log_counter_reset() ((void)0)
     #define log_print_string(...) ((void)0)
     #define log_print_stack_string(...) ((void)0)
     #define log_print_data(...) ((void)0)
+    #define log_print_task_stats(...) ((void)0)
+    #define log_print_timer_stats(...) ((void)0)
 #endif
 
 #endif /* __LOG_H_ */
@@ -37,12 +37,30 @@ enum
 {
     __ng_max_nodes__ = NODE_GLOBALS_MAX_NODES,
 };
-extern size_t __ng_node_id__;
+#ifdef NODE_GLOBALS_THREAD_LOCAL
+// every thread selects the active node by itself, e.g. when nodes are simulated in parallel
+#define __NG_THREAD_LOCAL__ __thread
+#else
+#define __NG_THREAD_LOCAL__
+#endif
+
+extern __NG_THREAD_LOCAL__ size_t __ng_node_id__;
 __LINK_C void set_node_global_id(size_t node_id);
 static inline size_t get_node_global_id() { assert(__ng_node_id__ < __ng_max_nodes__); return __ng_node_id__; }
 
+#if defined(NODE_GLOBALS_CONTEXT)
+// All NGDEF variables are placed in one section, which serves as the template of the context
+// of a node: every node gets a copy of it, allocated when the node is first selected. The state
+// of a node is contiguous in memory, and selecting a node only changes a single pointer.
+extern char __start_ng_context[];
+extern __NG_THREAD_LOCAL__ char* __ng_context__;
+
+#define NG(var)			(*(__typeof__(__ng_glob_ ## var ## __)*)(__ng_context__ + ((char*)&__ng_glob_ ## var ## __ - __start_ng_context)))
+#define NGDEF(var)		(__attribute__((section("ng_context"))) __ng_glob_ ## var ## __)
+#else
 #define NG(var)			(__ng_glob_ ## var ## __[(get_node_global_id())])
 #define NGDEF(var)		(__ng_glob_ ## var ## __[__ng_max_nodes__])
+#endif
 
 #else
 
@@ -0,0 +1,183 @@
+/* * OSS-7 - An opensource implementation of the DASH7 Alliance Protocol for ultra
+ * lowpower wireless sensor communication
+ *
+ * Copyright 2015 University of Antwerp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*! \file pt.h
+ * \addtogroup pt
+ * \ingroup framework
+ * @{
+ * \brief Stackless coroutines (protothreads) which are resumed by the scheduler
+ *
+ * A protothread is a function which can wait for a timer, for a signal (for instance from a radio callback)
+ * or for a condition in the middle of its code, so a sequence of steps can be written as straight-line code
+ * instead of a state machine spread over several tasks:
+ *
+ * \code{.c}
+ * static pt_t NGDEF(_csma_pt);
+ * #define csma_pt NG(_csma_pt)
+ *
+ * static void rssi_valid(int16_t rssi) { cur_rssi = rssi; pt_signal(&csma_pt); }
+ *
+ * static pt_state_t csma(pt_t* pt)
+ * {
+ *     PT_BEGIN(pt);
+ *     PT_AWAIT_DELAY(pt, t_offset);
+ *     hw_radio_set_rx(&rx_cfg, NULL, &rssi_valid);
+ *     PT_AWAIT_SIGNAL(pt);
+ *     ...
+ *     PT_END(pt);
+ * }
+ *
+ * pt_start(&csma_pt, &csma, MAX_PRIORITY);
+ * \endcode
+ *
+ * Protothreads have no stack of their own: the function returns every time it waits and is called again by
+ * the scheduler, as an event (see sched_post_event_prio()), when it is resumed. Execution continues after the
+ * statement it was waiting in. This means that the values of local variables are NOT preserved while waiting,
+ * state which is needed afterwards has to be kept in static (node global) variables or in a struct containing the
+ * pt_t. Also, a protothread may not wait from within a switch statement of its own.
+ *
+ * A protothread is resumed when pt_signal() is called, when its timer expires or when it yields. It then checks
+ * the condition it is waiting for, so a thread waiting with PT_WAIT_UNTIL() should be signalled by the code
+ * changing the condition. Each running protothread uses at most one scheduler event record and one timer at any time,
+ * and a second timer while the scheduler is out of event records.
+ */
+#ifndef PT_H_
+#define PT_H_
+
+#include "link_c.h"
+#include "types.h"
+#include "scheduler.h"
+#include "timer.h"
+
+/*! \brief The value returned by a protothread to the scheduler */
+typedef enum
+{
+    PT_WAITING = 0,
+    PT_YIELDED = 1,
+    PT_EXITED = 2,
+    PT_ENDED = 3,
+} pt_state_t;
+
+typedef struct pt pt_t;
+
+/*! \brief Type definition for the function of a protothread */
+typedef pt_state_t (*pt_thread_t)(pt_t* pt);
+
+/*! \brief The state of a protothread, which must stay allocated while it is running */
+struct pt
+{
+    uint16_t lc;                  // the line at which the thread continues
+    pt_thread_t thread;           // NULL when the thread is not running
+    uint8_t priority;
+    volatile bool scheduled;
+    volatile bool signalled;
+    volatile bool timer_expired;
+    bool timer_set;               // false while the timer of PT_AWAIT_TIME() still has to be posted
+    timer_tick_t timer_time;
+};
+
+/*! \brief Start a protothread, which is executed by the scheduler at the given priority
+ *
+ * \param pt		The state of the protothread
+ * \param thread	The function of the protothread
+ * \param priority	The priority at which the thread is executed every time it is resumed
+ *
+ * \return error_t	SUCCESS if the thread was started
+ *			EALREADY if the thread is still running
+ *			ESIZE if the priority is not between MAX_PRIORITY and MIN_PRIORITY
+ */
+__LINK_C error_t pt_start(pt_t* pt, pt_thread_t thread, uint8_t priority);
+
+/*! \brief Stop a running protothread, the thread will not be resumed any more
+ *
+ * \param pt		The state of the protothread
+ */
+__LINK_C void pt_stop(pt_t* pt);
+
+/*! \brief Check whether a protothread is running (has been started and did not end yet) */
+static inline bool pt_is_running(pt_t* pt) { return pt->thread != 0x0; }
+
+/*! \brief Signal a protothread, which resumes it if it is waiting in PT_AWAIT_SIGNAL()
+ *
+ * This can be called from an interrupt, for instance from a radio callback. Signalling a thread which is not
+ * waiting for a signal makes its next PT_AWAIT_SIGNAL() return immediately.
+ *
+ * \param pt		The state of the protothread
+ */
+__LINK_C void pt_signal(pt_t* pt);
+
+/*! \brief Resume a protothread, which re-evaluates the condition it is waiting for
+ *
+ * This can be called from an interrupt.
+ *
+ * \param pt		The state of the protothread
+ */
+__LINK_C void pt_resume(pt_t* pt);
+
+/*! \brief Start the timer of a protothread, used by PT_AWAIT_TIME(). Do not call this directly */
+__LINK_C void pt_set_timer(pt_t* pt, timer_tick_t time);
+
+/*! \brief Check whether the timer of a protothread expired, used by PT_AWAIT_TIME(). Do not call this directly */
+__LINK_C bool pt_is_timer_expired(pt_t* pt);
+
+/*! \brief Consume a pending signal of a protothread, used by PT_AWAIT_SIGNAL(). Do not call this directly */
+__LINK_C bool pt_take_signal(pt_t* pt);
+
+/*! \brief Mark the start of a protothread, must be the first statement of its function */
+#define PT_BEGIN(pt) switch((pt)->lc) { case 0:
+
+/*! \brief Mark the end of a protothread, must be the last statement of its function */
+#define PT_END(pt) } (pt)->lc = 0; return PT_ENDED
+
+/*! \brief Wait until the condition is true, which is checked every time the thread is resumed */
+#define PT_WAIT_UNTIL(pt, condition)                                   \
+    do {                                                               \
+        (pt)->lc = __LINE__; case __LINE__:                            \
+        if(!(condition))                                               \
+            return PT_WAITING;                                         \
+    } while(0)
+
+/*! \brief Wait until pt_signal() is called */
+#define PT_AWAIT_SIGNAL(pt) PT_WAIT_UNTIL(pt, pt_take_signal(pt))
+
+/*! \brief Wait until the given time (in timer ticks, see timer_get_counter_value()) */
+#define PT_AWAIT_TIME(pt, time)                                        \
+    do {                                                               \
+        pt_set_timer(pt, time);                                        \
+        PT_WAIT_UNTIL(pt, pt_is_timer_expired(pt));                    \
+    } while(0)
+
+/*! \brief Wait for the given number of timer ticks */
+#define PT_AWAIT_DELAY(pt, delay) PT_AWAIT_TIME(pt, timer_get_counter_value() + (delay))
+
+/*! \brief Let the scheduler execute other tasks and events before continuing */
+#define PT_YIELD(pt)                                                   \
+    do {                                                               \
+        (pt)->lc = __LINE__;                                           \
+        pt_resume(pt);                                                 \
+        return PT_YIELDED;                                             \
+        case __LINE__:;                                                \
+    } while(0)
+
+/*! \brief Stop the protothread from within the thread */
+#define PT_EXIT(pt) do { (pt)->lc = 0; return PT_EXITED; } while(0)
+
+#endif /* PT_H_ */
+
+/** @}*/
@@ -31,12 +31,25 @@
 #include "link_c.h"
 #include "types.h"
 #include "errors.h"
+#include "framework_defs.h"
 
 /*! \brief Type definition for tasks
  *
  */
 typedef void (*task_t)();
 
+/*! \brief Type definition for the handle of a registered task
+ *
+ * Posting or cancelling a task using its handle takes constant time, while doing so using the task
+ * itself requires a lookup of the task. Use the handle on time critical paths, e.g. from interrupt context.
+ */
+typedef uint8_t task_handle_t;
+
+/*! \brief Type definition for the handler of an event
+ *
+ */
+typedef void (*event_handler_t)(void* arg);
+
 /*! \brief Initialise the scheduler sub system. 
  *
  * This function is called while bootstrapping the framework. On no account should you call this function 
@@ -81,9 +94,9 @@ enum
  *
  * \param task		The task to register
  *
- * \return error_t 	SUCCESS if the task was registered successfully
+ * \return task_handle_t	The handle of the task, which can be used to post or cancel it
  */
-__LINK_C error_t sched_register_task(task_t task);
+__LINK_C task_handle_t sched_register_task(task_t task);
 
 /*! \brief Post a task with the given priority
  *
@@ -98,6 +111,27 @@ __LINK_C error_t sched_register_task(task_t task);
  */
 __LINK_C error_t sched_post_task_prio(task_t task, uint8_t priority);
 
+/*! \brief Post a task with the given priority, using its handle
+ *
+ * \param handle	The handle of the task, as returned by sched_register_task()
+ * \param priority	The priority of the task
+ *
+ * \return error_t	SUCCESS if the task was successfully scheduled
+ *			EINVAL if the handle does not belong to a registered task
+ *			ESIZE if the priority is not between MAX_PRIORITY and MIN_PRIORITY
+ *			EALREADY if the task was already scheduled. If this is the case,
+ *			the task will be executed but only once.
+ */
+__LINK_C error_t sched_post_handle_prio(task_handle_t handle, uint8_t priority);
+
+/*! \brief Post a task at the default priority, using its handle
+ *
+ * \param handle	The handle of the task, as returned by sched_register_task()
+ *
+ * \return error_t	See sched_post_handle_prio()
+ */
+static inline error_t sched_post_handle(task_handle_t handle) { return sched_post_handle_prio(handle, DEFAULT_PRIORITY); }
+
 /*! \brief Post a task at the default priority
  *
  * \param task		The task to be executed by the scheduler
@@ -119,16 +153,125 @@ static inline error_t sched_post_task(task_t task) { return sched_post_task_prio
  */
 __LINK_C error_t sched_cancel_task(task_t task);
 
+/*! \brief Cancel an already scheduled task, using its handle
+ *
+ * \param handle	The handle of the task, as returned by sched_register_task()
+ *
+ * \return error_t	SUCCESS if the task was cancelled successfully
+ * 			EINVAL if the handle does not belong to a registered task
+ *			EALREADY if the task was not scheduled or has already been executed
+ */
+__LINK_C error_t sched_cancel_handle(task_handle_t handle);
+
+/*! \brief Post a task which has to be executed before the given deadline
+ *
+ * Tasks posted with a deadline are executed earliest deadline first, before all tasks and events posted with
+ * a priority. Use this for time critical work, such as radio timing, which would otherwise have to compete
+ * with all other work at MAX_PRIORITY. When a task starts executing after its deadline, this is counted
+ * (see sched_get_missed_deadlines()), the task is executed anyway.
+ *
+ * \param task		The task to be executed by the scheduler
+ * \param deadline	The deadline, as an absolute time in timer ticks (see timer_get_counter_value())
+ *
+ * \return error_t	SUCCESS if the task was successfully scheduled
+ *			EINVAL if the task was not registered with the scheduler
+ *			EALREADY if the task was already scheduled, with a deadline or a priority.
+ *			If this is the case, the task will be executed but only once.
+ */
+__LINK_C error_t sched_post_task_deadline(task_t task, uint32_t deadline);
+
+/*! \brief Post a task which has to be executed before the given deadline, using its handle
+ *
+ * \param handle	The handle of the task, as returned by sched_register_task()
+ * \param deadline	The deadline, as an absolute time in timer ticks (see timer_get_counter_value())
+ *
+ * \return error_t	See sched_post_task_deadline()
+ */
+__LINK_C error_t sched_post_handle_deadline(task_handle_t handle, uint32_t deadline);
+
+/*! \brief Get the number of tasks posted with a deadline which started executing after their deadline */
+__LINK_C uint32_t sched_get_missed_deadlines();
+
 /*! \brief Check whether a task is scheduled to be executed
  *
  * \return bool		TRUE if the task is scheduled, FALSE otherwise
  */
 __LINK_C bool sched_is_scheduled(task_t task);
 
+/*! \brief Post an event: a handler which is executed once with the given argument
+ *
+ * Unlike tasks, handlers do not need to be registered and the same handler can be pending several times
+ * (with the same or a different argument), for example to process every frame of a burst. Pending events
+ * are kept in a pool of FRAMEWORK_SCHEDULER_MAX_EVENTS records. Events are executed in FIFO order per
+ * priority; at the same priority, pending events are executed before pending tasks.
+ *
+ * \param handler	The handler to execute
+ * \param arg		The argument passed to the handler
+ * \param priority	The priority of the event
+ *
+ * \return error_t	SUCCESS if the event was successfully scheduled
+ *			EINVAL if the handler is NULL
+ *			ESIZE if the priority is not between MAX_PRIORITY and MIN_PRIORITY
+ *			ENOMEM if no event records are left
+ */
+__LINK_C error_t sched_post_event_prio(event_handler_t handler, void* arg, uint8_t priority);
+
+/*! \brief Post an event at the default priority
+ *
+ * \return error_t	See sched_post_event_prio()
+ */
+static inline error_t sched_post_event(event_handler_t handler, void* arg) { return sched_post_event_prio(handler, arg, DEFAULT_PRIORITY); }
 
+
+/*! \brief Get the deepest low power mode the scheduler may use when idle */
 __LINK_C uint8_t sched_get_low_power_mode(void);
+
+/*! \brief Set the deepest low power mode the scheduler may use when idle
+ *
+ * When no tasks are waiting the scheduler enters the deepest low power mode, not deeper than this
+ * mode, from which the MCU can wake up in time for the next timer event (see hw_get_lowpower_mode_wakeup_latency()).
+ * Modes in which the timer does not run are only used when no timer event is pending.
+ *
+ * \param mode	The low power mode, as passed to hw_enter_lowpower_mode(). Defaults to FRAMEWORK_SCHEDULER_LP_MODE
+ */
 __LINK_C void    sched_set_low_power_mode(uint8_t mode);
 
+#ifdef FRAMEWORK_SCHEDULER_INSTRUMENTATION
+
+/*! \brief The execution statistics of a registered task, collected when the FRAMEWORK_SCHEDULER_INSTRUMENTATION
+ * CMake option is enabled.
+ *
+ * All times are expressed in timer ticks, as returned by timer_get_counter_value(). The latency is the time between
+ * posting the task and the start of its execution. Averages are obtained by dividing the totals by the number of runs.
+ */
+typedef struct
+{
+	task_t task;
+	uint32_t runs;
+	uint32_t total_exec_time;
+	uint32_t max_exec_time;
+	uint32_t total_latency;
+	uint32_t max_latency;
+} sched_task_stats_t;
+
+/*! \brief Get the execution statistics of a registered task
+ *
+ * \param handle	The handle of the task, as returned by sched_register_task()
+ * \param stats		The statistics are copied here
+ *
+ * \return error_t	SUCCESS if the statistics were copied
+ *			EINVAL if the handle does not belong to a registered task
+ */
+__LINK_C error_t sched_get_task_stats(task_handle_t handle, sched_task_stats_t* stats);
+
+/*! \brief Clear the execution statistics of all tasks */
+__LINK_C void sched_reset_stats();
+
+/*! \brief Log the execution statistics of all tasks, one log_print_task_stats() record per task */
+__LINK_C void sched_log_stats();
+
+#endif
+
 #endif /* SCHEDULER_H_ */
 
 /** @}*/
@@ -0,0 +1,92 @@
+/* * OSS-7 - An opensource implementation of the DASH7 Alliance Protocol for ultra
+ * lowpower wireless sensor communication
+ *
+ * Copyright 2015 University of Antwerp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file spsc_ring.h
+ * @addtogroup spsc_ring
+ * @ingroup framework
+ * @{
+ * @brief A ring buffer of bytes which is shared by a single producer and a single consumer, for instance
+ * an interrupt handler and a task, without disabling interrupts.
+ *
+ * The producer only updates the tail and the consumer only updates the head. Both are free running counters,
+ * which are masked to index the buffer, so the capacity has to be a power of two. Barriers make sure the data
+ * is written before the tail is published, and read before the head releases it.
+ */
+
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include "types.h"
+
+/**
+ * @brief This struct contains the state of the ring buffer
+ **/
+typedef struct {
+    volatile uint16_t head; /**< The number of bytes popped, only updated by the consumer */
+    volatile uint16_t tail; /**< The number of bytes put, only updated by the producer */
+    uint16_t mask;          /**< The capacity - 1 */
+    uint8_t* buffer;        /**< The buffer where the data is stored */
+} spsc_ring_t;
+
+/**
+ * @brief Initializes the ring buffer
+ * @param ring      Ring buffer state, initialized by this function
+ * @param buffer    The buffer used for the ring buffer, the caller is responsible for allocating capacity bytes
+ * @param capacity  The maximum number of bytes contained in the ring buffer, a power of two up to 32768
+ */
+void spsc_ring_init(spsc_ring_t* ring, uint8_t* buffer, uint16_t capacity);
+
+/**
+ * @brief Put bytes in the ring buffer. Only to be called by the producer.
+ * @param ring  Pointer to the ring buffer
+ * @param data  Pointer to the data to be put in the ring buffer
+ * @param len   Number of bytes to put in the ring buffer
+ * @returns SUCCESS or ESIZE when there is not enough space left (nothing is put in that case)
+ */
+error_t spsc_ring_put(spsc_ring_t* ring, uint8_t* data, uint16_t len);
+
+/**
+ * @brief Put a byte in the ring buffer. Only to be called by the producer.
+ * @param ring  Pointer to the ring buffer
+ * @param byte  Byte to be put in the ring buffer
+ * @returns SUCCESS or ESIZE when the ring buffer is full
+ */
+error_t spsc_ring_put_byte(spsc_ring_t* ring, uint8_t byte);
+
+/**
+ * @brief Read and pop up to len bytes from the ring buffer. Only to be called by the consumer.
+ * @param ring      Pointer to the ring buffer
+ * @param buffer    Pointer to the buffer where the bytes are copied to
+ * @param len       The maximum number of bytes to pop
+ * @returns The number of bytes popped
+ */
+uint16_t spsc_ring_pop(spsc_ring_t* ring, uint8_t* buffer, uint16_t len);
+
+/**
+ * @brief Returns the number of bytes currently in the ring buffer
+ * @param ring  Pointer to the ring buffer
+ * @return Number of bytes currently in the ring buffer. When called by the producer (consumer) more
+ *         bytes may have been popped (put) in the mean time.
+ */
+uint16_t spsc_ring_get_size(spsc_ring_t* ring);
+
+#endif // SPSC_RING_H
+
+/** @}*/
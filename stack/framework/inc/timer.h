@@ -53,6 +53,9 @@
 
 typedef uint32_t timer_tick_t;
 
+/*! \brief A tick count which does not overflow during the lifetime of the device */
+typedef uint64_t timer_tick64_t;
+
 typedef struct
 {
     task_t f;
@@ -92,6 +95,39 @@ __LINK_C void timer_init();
  */
 __LINK_C timer_tick_t timer_get_counter_value();
 
+/*! \brief Retrieve the current value of the extended (64-bit) counter of the timer
+ *
+ * The returned value is the number of clock ticks since the device booted. The lower 32 bits
+ * are equal to timer_get_counter_value().
+ *
+ * This function does not disable interrupts: the counter is read again when the overflow
+ * interrupt of the hardware timer updated it while it was being read.
+ *
+ * \return timer_tick64_t	The current value of the extended counter.
+ */
+__LINK_C timer_tick64_t timer_get_counter_value64();
+
+/*! \brief Returned by timer_get_next_event_delay() when no timer event is pending */
+#define TIMER_NO_EVENT_PENDING UINT32_MAX
+
+/*! \brief Get the number of ticks until the next timer event
+ *
+ * \return timer_tick_t	The number of ticks until the next event (0 if it is due already),
+ *				or TIMER_NO_EVENT_PENDING if no event is pending.
+ */
+__LINK_C timer_tick_t timer_get_next_event_delay();
+
+/*! \brief Set the number of ticks the hardware timer fires before a timer event is due
+ *
+ * This is used by the scheduler when entering a low power mode, to compensate for the wake-up latency
+ * of that mode: the task is posted when the event is due instead of a wake-up latency later.
+ * When the hardware timer fires before the event is due (because the MCU woke up faster), the timer
+ * waits for the fire time of the event, so tasks are never posted early.
+ *
+ * \param latency	The wake-up latency in ticks
+ */
+__LINK_C void timer_set_wakeup_latency(timer_tick_t latency);
+
 /*! \brief Post a task to be scheduled at a given time with a given priority
  *
  * The time parameter denotes the clock tick at which the task is to be scheduled
@@ -126,6 +162,15 @@ __LINK_C timer_tick_t timer_get_counter_value();
  */
 __LINK_C error_t timer_post_task_prio(task_t task, timer_tick_t time, uint8_t priority);
 
+/*! \brief Post a task to be scheduled at a given time on the extended (64-bit) time line
+ *
+ * This function behaves in the same way as timer_post_task_prio(), but the time is compared to
+ * timer_get_counter_value64(), so the task can be scheduled arbitrarily far in the future.
+ * timer_post_task_prio() interprets its time relative to the current time instead: at most 2^31 ticks
+ * in the past or in the future.
+ */
+__LINK_C error_t timer_post_task_prio64(task_t task, timer_tick64_t time, uint8_t priority);
+
 /*! \brief Post a task <task> to be scheduled at a given <time> with the default priority.
  *
  * This function is equivalent to
@@ -206,6 +251,102 @@ static inline error_t timer_post_task_delay(task_t task, timer_tick_t time) { re
 static inline error_t timer_add_event( timer_event* event) { return timer_post_task_prio(event->f, event->next_event, event->priority);}
 
 
+/*! \brief Post a task to be scheduled at a given time, or up to <slack> ticks later, with a given priority
+ *
+ * This function behaves in much the same way as timer_post_task_prio(), except that the task may be scheduled
+ * later than <time>, by at most <slack> ticks. The framework timer uses this to coalesce timers: the hardware
+ * timer is set to fire as late as the slack of the next timer (and of all other timers which are due by then)
+ * allows, and all timers which are due are handled in the same wake-up. Use this for timers which do not need
+ * to be exact (e.g. sensor sampling, timeouts, housekeeping) to reduce the number of wake-ups.
+ *
+ * \param task		The task to be scheduled at the given time.
+ * \param time		The earliest time at which to schedule the task for execution.
+ * \param slack		The number of ticks the task may be scheduled late.
+ * \param priority	The priority with which the task should be executed
+ *
+ * \returns error_t	See timer_post_task_prio()
+ */
+__LINK_C error_t timer_post_task_prio_slack(task_t task, timer_tick_t time, timer_tick_t slack, uint8_t priority);
+
+/*! \brief Post a task to be scheduled after a certain <delay>, or up to <slack> ticks later, with a given <priority>
+ *
+ * See timer_post_task_prio_slack() and timer_post_task_prio_delay().
+ */
+static inline error_t timer_post_task_prio_delay_slack(task_t task, timer_tick_t delay, timer_tick_t slack, uint8_t priority)
+{
+    return timer_post_task_prio_slack(task, timer_get_counter_value() + delay, slack, priority);
+}
+
+/*! \brief Post a task to be scheduled periodically, starting at a given time, with a given priority
+ *
+ * The task is scheduled at <time>, <time> + <period>, <time> + 2 * <period>, ... until it is cancelled using
+ * timer_cancel_task(). The timer is re-armed relative to the time it was due rather than to the time the
+ * task is executed, so the schedule does not drift. If the timer fires too late to catch up with a period
+ * (or the task is still waiting to be executed), that period is skipped.
+ * Posting a task which is already scheduled updates its time and period.
+ *
+ * \param task		The task to be scheduled periodically.
+ * \param time		The time at which to schedule the task for the first time.
+ * \param period	The number of ticks between two executions, 0 to schedule the task only once.
+ * \param slack		The number of ticks the task may be scheduled late, see timer_post_task_prio_slack()
+ * \param priority	The priority with which the task should be executed
+ *
+ * \returns error_t	See timer_post_task_prio()
+ */
+__LINK_C error_t timer_post_task_periodic(task_t task, timer_tick_t time, timer_tick_t period, timer_tick_t slack, uint8_t priority);
+
+/*! \brief Post an event (a handler with an argument) to be scheduled at a given time with a given priority
+ *
+ * This function behaves in much the same way as timer_post_task_prio(), except that the handler is posted
+ * with sched_post_event_prio() when the timer fires, so it does not need to be registered and is executed
+ * with the given argument. A handler can be posted several times with a different argument.
+ * Posting the same handler and argument again updates the time.
+ *
+ * \param handler	The handler to be executed at the given time.
+ * \param arg		The argument passed to the handler.
+ * \param time		The time at which to schedule the handler for execution.
+ * \param priority	The priority with which the handler should be executed
+ *
+ * \returns error_t	SUCCESS if the event was posted successfully
+ *					ENOMEM if the event could not be posted there are already too
+ *						   many timers waiting.
+ * 					EALREADY if the event was already scheduled with another priority.
+ *					EINVAL if the handler is NULL or an invalid priority was specified.
+ */
+__LINK_C error_t timer_post_event_prio(event_handler_t handler, void* arg, timer_tick_t time, uint8_t priority);
+
+/*! \brief Post an event to be scheduled at a given time on the extended (64-bit) time line
+ *
+ * See timer_post_event_prio() and timer_post_task_prio64().
+ */
+__LINK_C error_t timer_post_event_prio64(event_handler_t handler, void* arg, timer_tick64_t time, uint8_t priority);
+
+/*! \brief Post an event to be scheduled with a certain <delay> with a given <priority>
+ *
+ * See timer_post_event_prio() and timer_post_task_prio_delay().
+ */
+static inline error_t timer_post_event_prio_delay(event_handler_t handler, void* arg, timer_tick_t delay, uint8_t priority)
+{
+    return timer_post_event_prio(handler, arg, timer_get_counter_value() + delay, priority);
+}
+
+/*! \brief Post an event to be scheduled periodically, starting at a given time, with a given priority
+ *
+ * See timer_post_task_periodic() and timer_post_event_prio(). Several instances of the same handler
+ * can run concurrently, with a different argument.
+ */
+__LINK_C error_t timer_post_event_periodic(event_handler_t handler, void* arg, timer_tick_t time, timer_tick_t period, timer_tick_t slack, uint8_t priority);
+
+/*! \brief Cancel a previously posted event
+ *
+ * \param handler	The handler of the event to cancel.
+ * \param arg		The argument of the event to cancel.
+ *
+ * \return error_t	SUCCESS if the event was successfully canceled
+ * 					EALREADY if the event was not scheduled and therefore not canceled
+ */
+__LINK_C error_t timer_cancel_event(event_handler_t handler, void* arg);
+
 /*! \brief Cancel a previously scheduled task
  *
  * \param task	The task to cancel.
@@ -226,6 +367,59 @@ __LINK_C error_t timer_cancel_task(task_t task);
  */
 __LINK_C bool timer_is_task_scheduled(task_t task);
 
+#ifdef FRAMEWORK_TIMER_INSTRUMENTATION
+
+/*! \brief The number of buckets in the histograms of timer_latency_stats_t */
+#define TIMER_STATS_HISTOGRAM_SIZE 8
+
+/*! \brief The distribution of a latency, in timer ticks
+ *
+ * Bucket 0 of the histogram counts the latencies of 0 ticks, bucket i the latencies in [2^(i-1), 2^i) ticks and the
+ * last bucket all longer latencies.
+ */
+typedef struct
+{
+    uint32_t count;
+    timer_tick_t min;
+    timer_tick_t max;
+    uint32_t histogram[TIMER_STATS_HISTOGRAM_SIZE];
+} timer_latency_stats_t;
+
+/*! \brief The accuracy of the timer, collected when the FRAMEWORK_TIMER_INSTRUMENTATION CMake option is enabled.
+ *
+ * The fire latency is the time between the scheduled time of a timer event and the moment it is handled by the timer
+ * interrupt. This includes the slack allowed by the timer (see timer_post_task_prio_slack()) and the time a timer waits
+ * for a free scheduler event record. Timer events are never handled early (see timer_set_wakeup_latency()).
+ * The dispatch latency is the time between the scheduled time and the start of the execution of the posted task or event.
+ */
+typedef struct
+{
+    timer_latency_stats_t fire_latency;
+    timer_latency_stats_t dispatch_latency;
+} timer_stats_t;
+
+/*! \brief Get the accuracy statistics of the timer
+ *
+ * \param stats	The statistics are copied here
+ */
+__LINK_C void timer_get_stats(timer_stats_t* stats);
+
+/*! \brief Clear the accuracy statistics of the timer */
+__LINK_C void timer_reset_stats();
+
+/*! \brief Log the accuracy statistics of the timer, as a log_print_timer_stats() record */
+__LINK_C void timer_log_stats();
+
+/*! \brief Called by the scheduler before executing a task or event, to measure the dispatch latency of the timer.
+ *
+ * Either task is set, or handler and arg.
+ */
+__LINK_C void timer_record_dispatch(task_t task, event_handler_t handler, void* arg);
+
+#else
+    #define timer_record_dispatch(...) ((void)0)
+#endif
+
 #endif /* TIMER_H_ */
 
 /** @}*/
@@ -20,6 +20,8 @@
  *
  */
 
+#include <string.h>
+
 #include "debug.h"
 #include "ng.h"
 
@@ -51,25 +53,37 @@ static uint8_t process_action(uint8_t* alp_action, uint8_t* alp_response, uint8_
 
 }
 
+// the command and response fifos are linear buffers (they are never wrapped), so their contents can be
+// parsed and assembled in place
+static uint8_t* get_command_bytes(fifo_t* alp_command_fifo, uint16_t len) {
+  uint8_t* bytes;
+  uint16_t available = fifo_peek_contiguous(alp_command_fifo, &bytes);
+  assert(available >= len); // TODO return error instead of asserting
+  fifo_skip(alp_command_fifo, len);
+  return bytes;
+}
+
 static uint8_t process_op_read_file_data(fifo_t* alp_command_fifo, fifo_t* alp_response_fifo) {
   alp_operand_file_data_request_t operand;
-  error_t err;
-  err = fifo_pop(alp_command_fifo, &operand.file_offset.file_id, 1); assert(err == SUCCESS);
-  err = fifo_pop(alp_command_fifo, &operand.file_offset.offset, 1); assert(err == SUCCESS); // TODO can be 1-4 bytes, assume 1 for now
-  err = fifo_pop(alp_command_fifo, &operand.requested_data_length, 1); assert(err == SUCCESS);
+  // file ID, offset and requested length, which are repeated in the response
+  uint8_t* operand_bytes = get_command_bytes(alp_command_fifo, 3);
+  operand.file_offset.file_id = operand_bytes[0];
+  operand.file_offset.offset = operand_bytes[1]; // TODO can be 1-4 bytes, assume 1 for now
+  operand.requested_data_length = operand_bytes[2];
   DPRINT("READ FILE %i LEN %i", operand.file_offset.file_id, operand.requested_data_length);
 
   if(operand.requested_data_length <= 0)
     return 0; // TODO status
 
-  // fill response
-  err = fifo_put_byte(alp_response_fifo, ALP_OP_RETURN_FILE_DATA); assert(err == SUCCESS);
-  err = fifo_put_byte(alp_response_fifo, operand.file_offset.file_id); assert(err == SUCCESS);
-  err = fifo_put_byte(alp_response_fifo, operand.file_offset.offset); assert(err == SUCCESS); // TODO can be 1-4 bytes, assume 1 for now
-  err = fifo_put_byte(alp_response_fifo, operand.requested_data_length); assert(err == SUCCESS);
-  uint8_t data[operand.requested_data_length];
-  alp_status_codes_t alp_status = fs_read_file(operand.file_offset.file_id, operand.file_offset.offset, data, operand.requested_data_length); // TODO status
-  err = fifo_put(alp_response_fifo, data, operand.requested_data_length); assert(err == SUCCESS);
+  // fill response, the file is read directly into the response fifo
+  uint8_t* response;
+  uint16_t response_len = 4 + operand.requested_data_length;
+  uint16_t reserved_len = fifo_reserve(alp_response_fifo, &response);
+  assert(reserved_len >= response_len);
+  response[0] = ALP_OP_RETURN_FILE_DATA;
+  memmove(response + 1, operand_bytes, 3); // the response can be assembled in the command buffer (see d7asp.c)
+  alp_status_codes_t alp_status = fs_read_file(operand.file_offset.file_id, operand.file_offset.offset, response + 4, operand.requested_data_length); // TODO status
+  error_t err = fifo_commit(alp_response_fifo, response_len); assert(err == SUCCESS);
 }
 
 static uint8_t process_op_write_file_data(fifo_t* alp_command_fifo, fifo_t* alp_response_fifo) {
@@ -80,8 +94,7 @@ static uint8_t process_op_write_file_data(fifo_t* alp_command_fifo, fifo_t* alp_
   err = fifo_pop(alp_command_fifo, &operand.provided_data_length, 1); assert(err == SUCCESS);
   DPRINT("WRITE FILE %i LEN %i", operand.file_offset.file_id, operand.provided_data_length);
 
-  uint8_t data[operand.provided_data_length];
-  err = fifo_pop(alp_command_fifo, data, operand.provided_data_length);
+  uint8_t* data = get_command_bytes(alp_command_fifo, operand.provided_data_length);
   alp_status_codes_t alp_status = fs_write_file(operand.file_offset.file_id, operand.file_offset.offset, data, operand.provided_data_length); // TODO status
 }
 
@@ -144,8 +157,7 @@ bool alp_process_command(uint8_t* alp_command, uint8_t alp_command_length, uint8
       // forward rest of the actions over the D7ASP interface
       // TODO support multiple FIFOs
       uint8_t forwarded_alp_size = fifo_get_size(&alp_command_fifo);
-      uint8_t forwarded_alp_actions[forwarded_alp_size];
-      fifo_pop(&alp_command_fifo, forwarded_alp_actions, forwarded_alp_size);
+      uint8_t* forwarded_alp_actions = get_command_bytes(&alp_command_fifo, forwarded_alp_size);
       d7asp_master_session_t* session = d7asp_master_session_create(&d7asp_session_config);
       // TODO current_command.fifo_token = session->token;
       uint8_t expected_response_length = alp_get_expected_response_length(forwarded_alp_actions, forwarded_alp_size);
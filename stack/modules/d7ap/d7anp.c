@@ -27,6 +27,7 @@
 #include "log.h"
 #include "math.h"
 #include "hwdebug.h"
+#include "MODULE_D7AP_defs.h"
 
 #if defined(FRAMEWORK_LOG_ENABLED) && defined(MODULE_D7AP_NP_LOG_ENABLED)
 #define DPRINT(...) log_print_stack_string(LOG_STACK_NWL, __VA_ARGS__)
@@ -104,7 +105,7 @@ static void schedule_foreground_scan_expired_timer()
     // since this FG scan is started directly from the ISR (transmitted callback), I don't expect a significative delta between now and the transmission time
 
     DPRINT("starting foreground scan expiration timer (%i ticks)", fg_scan_timeout_ticks);
-    assert(timer_post_task_delay(&foreground_scan_expired, fg_scan_timeout_ticks) == SUCCESS);
+    assert(timer_post_task_prio_delay_slack(&foreground_scan_expired, fg_scan_timeout_ticks, MODULE_D7AP_TIMEOUT_SLACK, DEFAULT_PRIORITY) == SUCCESS);
 }
 
 void d7anp_start_foreground_scan()
@@ -144,7 +144,7 @@ static void schedule_response_period_timeout_handler(timer_tick_t timeout_ticks)
 
     DPRINT("Starting response_period timer (%i ticks)", timeout_ticks);
 
-    assert(timer_post_task_delay(&response_period_timeout_handler, timeout_ticks) == SUCCESS);
+    assert(timer_post_task_prio_delay_slack(&response_period_timeout_handler, timeout_ticks, MODULE_D7AP_TIMEOUT_SLACK, DEFAULT_PRIORITY) == SUCCESS);
 }
 
 
@@ -96,9 +96,19 @@ static bool NGDEF(_process_received_packets_after_tx);
 static bool NGDEF(_resume_fg_scan);
 #define resume_fg_scan NG(_resume_fg_scan)
 
+// the tasks posted from the radio interrupts, posted by handle to keep the interrupt handlers short
+static task_handle_t NGDEF(_process_received_packets_task);
+#define process_received_packets_task NG(_process_received_packets_task)
+
+static task_handle_t NGDEF(_notify_transmitted_packet_task);
+#define notify_transmitted_packet_task NG(_notify_transmitted_packet_task)
+
 // TODO defined somewhere?
 #define t_g	5
 
+// the radio timing critical tasks are posted with a deadline, so they are not delayed by other work posted at MAX_PRIORITY
+#define RADIO_TASK_DEADLINE() (timer_get_counter_value() + t_g)
+
 static void execute_cca();
 static void execute_csma_ca();
 static void start_foreground_scan();
@@ -229,24 +239,45 @@ static bool is_tx_busy()
     }
 }
 
-static void process_received_packets()
+static void process_received_packet(packet_t* packet)
+{
+    DPRINT("Processing received packet");
+    packet_queue_mark_processing(packet);
+    packet_disassemble(packet);
+}
+
+static bool defer_while_tx_busy()
 {
     if(is_tx_busy())
     {
-        // this task might be scheduled while a TX is busy (for example after scheduling an execute_cca()).
-        // make sure we don't start processing this packet before the TX is completed.
-        // will be rescheduled by packet_transmitted() or an CSMA failed.
+        // we might get here while a TX is busy (for example after scheduling an execute_cca()).
+        // make sure we don't start processing received packets before the TX is completed.
+        // process_received_packets() will be posted by packet_transmitted() or an CSMA failed.
         process_received_packets_after_tx = true;
-        return;
+        return true;
     }
 
-    packet_t* packet = packet_queue_get_received_packet();
-    assert(packet != NULL);
-    DPRINT("Processing received packet");
-    packet_queue_mark_processing(packet);
-    packet_disassemble(packet);
+    return false;
+}
+
+static void process_received_packets()
+{
+    // handles all packets which are still waiting, processing one can start a TX
+    packet_t* packet;
+    while(!defer_while_tx_busy() && (packet = packet_queue_get_received_packet()) != NULL)
+        process_received_packet(packet);
+}
+
+static void received_packet_event(void* arg)
+{
+    packet_t* packet = (packet_t*)arg;
+    if(!packet_queue_is_received(packet))
+        return; // already handled by process_received_packets()
+
+    if(defer_while_tx_busy())
+        return;
 
-    // TODO check if more received packets are pending
+    process_received_packet(packet);
 }
 
 void packet_received(hw_radio_packet_t* hw_radio_packet)
@@ -258,8 +289,9 @@ void packet_received(hw_radio_packet_t* hw_radio_packet)
     DPRINT("packet received @ %i , RSSI = %i", hw_radio_packet->rx_meta.timestamp, hw_radio_packet->rx_meta.rssi);
     packet_queue_mark_received(hw_radio_packet);
 
-    /* the received packet needs to be handled in priority */
-    sched_post_task_prio(&process_received_packets, MAX_PRIORITY);
+    /* the received packet needs to be handled in priority, every packet of a burst gets an event of its own */
+    if(sched_post_event_prio(&received_packet_event, packet_queue_find_packet(hw_radio_packet), MAX_PRIORITY) != SUCCESS)
+        sched_post_handle_prio(process_received_packets_task, MAX_PRIORITY); // no events left, handle all waiting packets at once
 }
 
 static void notify_transmitted_packet()
@@ -271,7 +303,7 @@ static void notify_transmitted_packet()
 
     if(process_received_packets_after_tx)
     {
-        sched_post_task_prio(&process_received_packets, MAX_PRIORITY);
+        sched_post_handle_prio(process_received_packets_task, MAX_PRIORITY);
         process_received_packets_after_tx = false;
     }
 
@@ -291,7 +323,7 @@ void packet_transmitted(hw_radio_packet_t* hw_radio_packet)
     packet_queue_mark_transmitted(hw_radio_packet);
 
     /* the notification task needs to be handled in priority */
-    sched_post_task_prio(&notify_transmitted_packet, MAX_PRIORITY);
+    sched_post_handle_deadline(notify_transmitted_packet_task, RADIO_TASK_DEADLINE());
 }
 
 static void discard_tx()
@@ -316,7 +348,7 @@ static void discard_tx()
         sched_cancel_task(&execute_csma_ca);
     }
     else if (dll_state == DLL_STATE_TX_FOREGROUND_COMPLETED)
-        sched_cancel_task(&notify_transmitted_packet);
+        sched_cancel_handle(notify_transmitted_packet_task);
 
     switch_state(DLL_STATE_IDLE);
 }
@@ -472,7 +504,7 @@ static void execute_csma_ca()
             else
             {
                 switch_state(DLL_STATE_CCA1);
-                sched_post_task_prio(&execute_cca, MAX_PRIORITY);
+                sched_post_task_deadline(&execute_cca, RADIO_TASK_DEADLINE());
             }
 
             break;
@@ -486,7 +518,7 @@ static void execute_csma_ca()
             {
                 DPRINT("CCA fail because dll_to = %i < %i ", dll_to, t_g);
                 switch_state(DLL_STATE_CCA_FAIL);
-                sched_post_task_prio(&execute_csma_ca, MAX_PRIORITY);
+                sched_post_task_deadline(&execute_csma_ca, RADIO_TASK_DEADLINE());
                 break;
             }
 
@@ -531,7 +563,7 @@ static void execute_csma_ca()
             else
             {
                 switch_state(DLL_STATE_CCA1);
-                sched_post_task_prio(&execute_cca, MAX_PRIORITY);
+                sched_post_task_deadline(&execute_cca, RADIO_TASK_DEADLINE());
             }
 
             break;
@@ -543,7 +575,7 @@ static void execute_csma_ca()
             d7anp_signal_transmission_failure();
             if (process_received_packets_after_tx)
             {
-                sched_post_task_prio(&process_received_packets, MAX_PRIORITY);
+                sched_post_handle_prio(process_received_packets_task, MAX_PRIORITY);
                 process_received_packets_after_tx = false;
             }
 
@@ -625,8 +657,8 @@ void dll_notify_access_profile_file_changed()
 
 void dll_init()
 {
-    sched_register_task(&process_received_packets);
-    sched_register_task(&notify_transmitted_packet);
+    process_received_packets_task = sched_register_task(&process_received_packets);
+    notify_transmitted_packet_task = sched_register_task(&notify_transmitted_packet);
     sched_register_task(&execute_cca);
     sched_register_task(&execute_csma_ca);
     sched_register_task(&dll_execute_scan_automation);
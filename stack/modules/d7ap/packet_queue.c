@@ -127,6 +127,18 @@ void packet_queue_mark_transmitted(hw_radio_packet_t* hw_radio_packet)
     assert(false);
 }
 
+bool packet_queue_is_received(packet_t* packet)
+{
+    for(uint8_t i = 0; i < MODULE_D7AP_PACKET_QUEUE_SIZE; i++)
+    {
+        if(packet == &(packet_queue[i]))
+            return packet_queue_element_status[i] == PACKET_QUEUE_ELEMENT_STATUS_RECEIVED;
+    }
+
+    assert(false);
+    return false;
+}
+
 packet_t* packet_queue_get_received_packet()
 {
     // note: we return the first found received packet, this may not be the oldest one
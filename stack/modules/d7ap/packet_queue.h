@@ -49,6 +49,9 @@ void packet_queue_mark_transmitted(hw_radio_packet_t*);
 /*! Indicates the supplied packet is being processed */
 void packet_queue_mark_processing(packet_t*);
 
+/*! Returns true if the packet was received and is still waiting for further processing */
+bool packet_queue_is_received(packet_t*);
+
 /*! Get a received packet for further processing. Returns NULL if no received packet queued. */
 packet_t* packet_queue_get_received_packet();
 
@@ -0,0 +1,113 @@
+/* * OSS-7 - An opensource implementation of the DASH7 Alliance Protocol for ultra
+ * lowpower wireless sensor communication
+ *
+ * Copyright 2015 University of Antwerp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+ * Checks the CRC implementation it is compiled with against the reference implementation
+ * and measures its throughput for a range of frame lengths.
+ * Prints one line per frame length: <implementation> <frame length> <bytes per second> <ns per byte>
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "crc.h"
+
+#define STR2(x) #x
+#define STR(x) STR2(x)
+
+#define MAX_LENGTH 255
+#define BENCHMARK_BYTES 50000000
+
+static uint16_t reference_crc(uint8_t* data, uint16_t length)
+{
+    uint16_t crc = 0xffff;
+    for(uint16_t i = 0; i < length; i++)
+    {
+        for(uint8_t bit = 0; bit < 8; bit++)
+        {
+            uint8_t in = ((data[i] >> (7 - bit)) & 1) ^ (crc >> 15);
+            crc <<= 1;
+            if(in)
+                crc ^= 0x1021;
+        }
+    }
+
+    return crc;
+}
+
+static int check(uint8_t* data)
+{
+    for(uint16_t length = 0; length <= MAX_LENGTH; length++)
+    {
+        uint16_t expected = reference_crc(data, length);
+        if(crc_calculate(data, length) != expected)
+        {
+            printf("error: wrong CRC for length %d\n", length);
+            return 1;
+        }
+
+        // the same CRC when the data is passed in two parts
+        uint16_t split = rand() % (length + 1);
+        uint16_t crc = crc_update(crc_init(), data, split);
+        crc = crc_final(crc_update(crc, data + split, length - split));
+        if(crc != expected)
+        {
+            printf("error: wrong CRC for length %d split at %d\n", length, split);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+static void benchmark(uint8_t* data, uint16_t length)
+{
+    uint32_t iterations = BENCHMARK_BYTES / length;
+    volatile uint16_t result;
+    clock_t start = clock();
+    for(uint32_t i = 0; i < iterations; i++)
+    {
+        data[0] = i; // avoid the calculation to be hoisted out of the loop
+        result = crc_calculate(data, length);
+    }
+
+    double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+    double bytes = (double)iterations * length;
+    printf("%s %d %.0f %.2f\n", STR(FRAMEWORK_CRC_IMPLEMENTATION), length, bytes / seconds, seconds * 1e9 / bytes);
+}
+
+int main(int argc, char** argv)
+{
+    uint8_t data[MAX_LENGTH];
+    srand(0);
+    for(uint16_t i = 0; i < MAX_LENGTH; i++)
+        data[i] = rand();
+
+    // the check values of the CRC-16/CCITT-FALSE, which is used by D7A
+    if(crc_calculate((uint8_t*)"123456789", 9) != 0x29B1 || check(data))
+        return 1;
+
+    uint16_t lengths[] = { 8, 16, 32, 64, 128, 255 };
+    for(uint8_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++)
+        benchmark(data, lengths[i]);
+
+    return 0;
+}
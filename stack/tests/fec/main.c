@@ -1,158 +1,321 @@
+/* * OSS-7 - An opensource implementation of the DASH7 Alliance Protocol for ultra
+ * lowpower wireless sensor communication
+ *
+ * Copyright 2015 University of Antwerp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+ * Benchmark and regression test of the FEC implementation it is compiled with (FEC_IMPLEMENTATION):
+ * - checks that frames of every length up to FEC_MAX_FRAME_LENGTH survive encoding and decoding
+ * - measures the encode and decode throughput for a range of frame lengths
+ * - measures the bit and packet error rates for a range of channel bit error rates, using Monte-Carlo simulation
+ *   of a random (independent bit errors) and/or a burst (Gilbert-Elliott) error model
+ * Every result is printed on one line, so the output of the implementations can be compared and tracked:
+ *   throughput <implementation> <operation> <frame length> <bytes per second> <cycles per byte>
+ *   ber <implementation> <model> <channel BER> <BER> <PER>
+ * Lines starting with # are comments. The cycles per byte are 0 on hosts without a cycle counter.
+ *
+ * Usage: fec_<implementation> [-p packets per BER point] [-s bytes per throughput measurement]
+ *                             [-m random|burst|all] [-L mean burst length in bits]
+ */
+
 #include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 #include <time.h>
-#include <stdlib.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAS_CYCLE_COUNTER
+#endif
+
 #include "fec.h"
 
-#define BINARY 0
+#define STR2(x) #x
+#define STR(x) STR2(x)
+
+#define MAX_ENCODED_LENGTH (2 * (FEC_MAX_FRAME_LENGTH + 3))
+#define BER_FRAME_LENGTH 32
+
+#define DEFAULT_PACKETS 1000
+#define DEFAULT_BENCHMARK_BYTES 2000000
+#define DEFAULT_BURST_LENGTH 8
+
+typedef enum {
+	ERROR_MODEL_RANDOM = 1,
+	ERROR_MODEL_BURST = 2,
+	ERROR_MODEL_ALL = ERROR_MODEL_RANDOM | ERROR_MODEL_BURST
+} error_model_t;
 
+static const uint16_t frame_lengths[] = {8, 16, 32, 64, 124, 255};
+static const double channel_bers[] = {1e-3, 2e-3, 5e-3, 1e-2, 2e-2, 5e-2};
 
-const char *byte_to_binary(uint8_t x)
+static uint64_t random_state = 0x853C49E6748FEA9BULL;
+
+// xorshift64*, reproducible on every host
+static uint32_t get_random()
 {
-    static char b[9];
-    b[0] = '\0';
+	random_state ^= random_state >> 12;
+	random_state ^= random_state << 25;
+	random_state ^= random_state >> 27;
+	return (random_state * 0x2545F4914F6CDD1DULL) >> 32;
+}
 
-    uint8_t z;
-    for (z = 128; z > 0; z >>= 1)
-    {
-        strcat(b, ((x & z) == z) ? "1" : "0");
-    }
+static double get_random_probability()
+{
+	return get_random() / 4294967296.0;
+}
 
-    return b;
+static uint64_t get_cycles()
+{
+#ifdef HAS_CYCLE_COUNTER
+	return __rdtsc();
+#else
+	return 0;
+#endif
 }
 
-unsigned char Partab[] = { 0,1,1,0,1,0,0,1,1,0,0,1,0,1,1,0,1,0,0,1,0,1,1,0,0,1,1,0,1,0,0,1,1,0,0,1,0,1,1,0,0,1,1,0,1,0,0,1,0,1,1,0,1,0,0,1,1,0,0,1,0,1,1,0,1,0,0,1,0,1,1,0,0,1,1,0,1,0
-,0,1,0,1,1,0,1,0,0,1,1,0,0,1,0,1,1,0,0,1,1,0,1,0,0,1,1,0,0,1,0,1,1,0,1,0,0,1,0,1,1,0,0,1,1,0,1,0,0,1,1,0,0,1,0,1,1,0,0,1,1,0,1,0,0,1,0,1,1,0,1,0,0,1,1,0,0,1,0,1,1,0,0,1,1,0,1,0,0,1,1
-,0,0,1,0,1,1,0,1,0,0,1,0,1,1,0,0,1,1,0,1,0,0,1,0,1,1,0,1,0,0,1,1,0,0,1,0,1,1,0,1,0,0,1,0,1,1,0,0,1,1,0,1,0,0,1,1,0,0,1,0,1,1,0,0,1,1,0,1,0,0,1,0,1,1,0,1,0,0,1,1,0,0,1,0,1,1,0,};
+static double get_seconds()
+{
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec / 1e9;
+}
 
-#define TRELLIS_TERMINATOR 0x0B
-const static uint8_t fec_lut[16] = {0, 3, 1, 2, 3, 0, 2, 1, 3, 0, 2, 1, 0, 3, 1, 2};
+static uint32_t count_bit_errors(const uint8_t* a, const uint8_t* b, uint16_t length)
+{
+	uint32_t errors = 0;
+	uint16_t i;
+	for (i = 0; i < length; i++)
+		errors += __builtin_popcount(a[i] ^ b[i]);
+
+	return errors;
+}
 
+static void fill_random(uint8_t* data, uint16_t length)
+{
+	uint16_t i;
+	for (i = 0; i < length; i++)
+		data[i] = get_random();
+}
+
+static int check_round_trip()
+{
+	uint8_t data[FEC_MAX_FRAME_LENGTH];
+	uint8_t buffer[MAX_ENCODED_LENGTH];
+	uint16_t length;
+	for (length = 1; length <= FEC_MAX_FRAME_LENGTH; length++)
+	{
+		fill_random(data, length);
+		memcpy(buffer, data, length);
+		uint16_t encoded_length = fec_encode(buffer, length);
+		// the frame is terminated with 2 or 3 bytes, to an even number of bytes
+		if (encoded_length != 2 * (length + 2 + length % 2))
+		{
+			printf("# encoding a %d byte frame gives %d bytes\n", length, encoded_length);
+			return 0;
+		}
+
+		fec_decode_packet(buffer, encoded_length, encoded_length);
+		if (memcmp(data, buffer, length) != 0)
+		{
+			printf("# decoding a %d byte frame failed\n", length);
+			return 0;
+		}
+	}
+
+	return 1;
+}
 
+static void print_throughput(const char* operation, uint16_t length, uint32_t bytes, double seconds, uint64_t cycles)
+{
+	printf("throughput %s %s %d %.0f %.1f\n", STR(FEC_IMPLEMENTATION), operation, length, bytes / seconds,
+		   (double) cycles / bytes);
+}
 
-void test_interleaver()
+// the throughput is given in frame bytes (before encoding) per second, the frame is copied into the buffer for every
+// iteration since both operations work in place
+static void benchmark_throughput(uint32_t benchmark_bytes)
 {
-	uint8_t fecbuffer[4] = {0xFF,0x00,0xAB,0x00};
-	uint8_t buffer[4]= {0,0,0,0};
-	uint8_t buffer2[4]= {0,0,0,0};
-	uint8_t *output = buffer;
-	uint8_t *input = buffer;
-
-	*output++ = ((fecbuffer[0] & 0x03)) |\
-				((fecbuffer[1] & 0x03) << 2) |\
-				((fecbuffer[2] & 0x03) << 4) |\
-				((fecbuffer[3] & 0x03) << 6);
-	*output++ = (((fecbuffer[0] >> 2) & 0x03)) |\
-					(((fecbuffer[1] >> 2) & 0x03) << 2) |\
-					(((fecbuffer[2] >> 2) & 0x03) << 4) |\
-					(((fecbuffer[3] >> 2) & 0x03) << 6);
-	*output++ = (((fecbuffer[0] >> 4) & 0x03)) |\
-					(((fecbuffer[1] >> 4) & 0x03) << 2) |\
-					(((fecbuffer[2] >> 4) & 0x03) << 4) |\
-					(((fecbuffer[3] >> 4) & 0x03) << 6);
-	*output++ = (((fecbuffer[0] >> 6) & 0x03)) |\
-					(((fecbuffer[1] >> 6) & 0x03) << 2) |\
-					(((fecbuffer[2] >> 6) & 0x03) << 4) |\
-					(((fecbuffer[3] >> 6) & 0x03) << 6);
-
-	printf("Input : "); print_array((uint8_t*) fecbuffer, 4, BINARY); printf("\n");
-	printf("Interl: "); print_array((uint8_t*) buffer, 4, BINARY); printf("\n");
-
-	fecbuffer[0] = ((input[0] & 0x03)) |\
-				((input[1] & 0x03) << 2) |\
-				((input[2] & 0x03) << 4) |\
-				((input[3] & 0x03) << 6);
-	fecbuffer[1] = (((input[0] >> 2) & 0x03)) |\
-					(((input[1] >> 2) & 0x03) << 2) |\
-					(((input[2] >> 2) & 0x03) << 4) |\
-					(((input[3] >> 2) & 0x03) << 6);
-	fecbuffer[2] = (((input[0] >> 4) & 0x03)) |\
-					(((input[1] >> 4) & 0x03) << 2) |\
-					(((input[2] >> 4) & 0x03) << 4) |\
-					(((input[3] >> 4) & 0x03) << 6);
-	fecbuffer[3] = (((input[0] >> 6) & 0x03)) |\
-					(((input[1] >> 6) & 0x03) << 2) |\
-					(((input[2] >> 6) & 0x03) << 4) |\
-					(((input[3] >> 6) & 0x03) << 6);
-
-
-	printf("Deint : "); print_array((uint8_t*) fecbuffer, 4, BINARY); printf("\n");
+	printf("# throughput, implementation, operation, frame length, bytes per second, cycles per byte\n");
+
+	uint8_t i;
+	for (i = 0; i < sizeof(frame_lengths) / sizeof(frame_lengths[0]); i++)
+	{
+		uint16_t length = frame_lengths[i];
+		if (length > FEC_MAX_FRAME_LENGTH)
+			continue;
+
+		uint8_t data[MAX_ENCODED_LENGTH];
+		uint8_t encoded[MAX_ENCODED_LENGTH];
+		uint8_t buffer[MAX_ENCODED_LENGTH];
+		fill_random(data, length);
+		memcpy(encoded, data, length);
+		uint16_t encoded_length = fec_encode(encoded, length);
+		uint32_t iterations = benchmark_bytes / length + 1;
+		uint32_t n;
+
+		double start = get_seconds();
+		uint64_t start_cycles = get_cycles();
+		for (n = 0; n < iterations; n++)
+		{
+			memcpy(buffer, data, length);
+			fec_encode(buffer, length);
+		}
+		print_throughput("encode", length, iterations * length, get_seconds() - start, get_cycles() - start_cycles);
+
+		start = get_seconds();
+		start_cycles = get_cycles();
+		for (n = 0; n < iterations; n++)
+		{
+			memcpy(buffer, encoded, encoded_length);
+			fec_decode_packet(buffer, encoded_length, encoded_length);
+		}
+		print_throughput("decode", length, iterations * length, get_seconds() - start, get_cycles() - start_cycles);
+
+#ifdef FEC_FRAMEWORK
+		uint8_t soft_bits[MAX_ENCODED_LENGTH * 8];
+		uint16_t j;
+		for (j = 0; j < encoded_length * 8; j++)
+			soft_bits[j] = ((encoded[j / 8] >> (7 - j % 8)) & 0x01) ? FEC_SOFT_BIT_MAX : 0;
+
+		start = get_seconds();
+		start_cycles = get_cycles();
+		for (n = 0; n < iterations; n++)
+			fec_decode_packet_soft(soft_bits, encoded_length, buffer);
+		print_throughput("decode_soft", length, iterations * length, get_seconds() - start, get_cycles() - start_cycles);
+
+		fec_pn9_t pn9;
+		fec_pn9_init(&pn9);
+		start = get_seconds();
+		start_cycles = get_cycles();
+		for (n = 0; n < iterations; n++)
+			fec_pn9_apply(&pn9, buffer, length);
+		print_throughput("pn9", length, iterations * length, get_seconds() - start, get_cycles() - start_cycles);
+#endif
+	}
+}
 
+// flip the bits of the encoded data according to the error model, for an average bit error rate of ber
+static void add_errors(uint8_t* data, uint16_t length, error_model_t model, double ber, uint8_t burst_length)
+{
+	// Gilbert-Elliott model: no errors in the good state and 50% errors in the bad state, which lasts burst_length bits
+	// on average. The bad state is entered with the probability which gives the requested average BER
+	double bad_fraction = 2 * ber;
+	double enter_bad = bad_fraction / (burst_length * (1 - bad_fraction));
+	uint8_t bad = 0;
+
+	uint16_t i;
+	for (i = 0; i < length * 8; i++)
+	{
+		uint8_t error;
+		if (model == ERROR_MODEL_RANDOM)
+			error = get_random_probability() < ber;
+		else
+		{
+			if (bad)
+				bad = get_random_probability() >= 1.0 / burst_length;
+			else
+				bad = get_random_probability() < enter_bad;
+
+			error = bad && (get_random() & 0x01);
+		}
+
+		if (error)
+			data[i / 8] ^= 0x80 >> (i % 8);
+	}
+}
 
+static void simulate_errors(error_model_t model, uint32_t packets, uint8_t burst_length)
+{
+	const char* model_name = model == ERROR_MODEL_RANDOM ? "random" : "burst";
+	uint8_t i;
+	for (i = 0; i < sizeof(channel_bers) / sizeof(channel_bers[0]); i++)
+	{
+		uint32_t bit_errors = 0, packet_errors = 0;
+		uint32_t n;
+		for (n = 0; n < packets; n++)
+		{
+			uint8_t data[BER_FRAME_LENGTH];
+			uint8_t buffer[MAX_ENCODED_LENGTH];
+			fill_random(data, BER_FRAME_LENGTH);
+			memcpy(buffer, data, BER_FRAME_LENGTH);
+			uint16_t encoded_length = fec_encode(buffer, BER_FRAME_LENGTH);
+			add_errors(buffer, encoded_length, model, channel_bers[i], burst_length);
+			fec_decode_packet(buffer, encoded_length, encoded_length);
+
+			uint32_t errors = count_bit_errors(data, buffer, BER_FRAME_LENGTH);
+			bit_errors += errors;
+			packet_errors += errors > 0;
+		}
+
+		printf("ber %s %s %.1e %.3e %.3e\n", STR(FEC_IMPLEMENTATION), model_name, channel_bers[i],
+			   (double) bit_errors / (packets * BER_FRAME_LENGTH * 8), (double) packet_errors / packets);
+	}
 }
 
 int main(int argc, char *argv[])
 {
-	//test_interleaver();
-	uint8_t input[] = {0x19,0x00,0x80,0x00,0x0B,0x57,0x00,0x00,0x07,0x8C,0x63,0x20,0x00,0x0B,0x57,0x00,0x00,0x07,0x8F,0x52,0x41,0x07,0x00,0x00,0xD0,0x81};
-	uint8_t input_length = sizeof(input);
-	uint8_t encoded[255];
-	uint8_t decoded[255];
-	uint8_t errors[255];
-
-	memset(errors, 0, 255);
-
-
-	printf("Input: %d ", input_length);
-	print_array(input, input_length, BINARY);
-	printf("\n");
-
-	memcpy(encoded, input, input_length);
-
-	uint16_t lenght_encoded = fec_encode(encoded, input_length);
-
-	printf("Encoded: %d ", lenght_encoded);
-	print_array(encoded, lenght_encoded, BINARY);
-	printf("\n");
-
-	memcpy(decoded, encoded, lenght_encoded);
-
-
-	uint8_t length_decoded =  fec_decode_packet(decoded, lenght_encoded, 255);
-
-	printf("Decoded: %d ", length_decoded);
-	print_array(decoded, length_decoded, BINARY);
-	printf("\n");
-
-	int nr_errors = 1;
-	int notrecovered = 0;
-	srand(time(NULL));
-
-//	while (notrecovered < 1)
-//	{
-//		int r = rand() % (lenght_encoded * 8);
-//		//printf("Rand: %d\n", r);
-//
-//		encoded[r/8] ^= 1 << r % 8;
-//		errors[r/8] ^= 1 << r % 8;
-//		printf("Errors %d - BER %d%%\n", nr_errors, (nr_errors * 100) / (lenght_encoded * 8));
-//		printf("Error: ");
-//		print_array(errors, lenght_encoded);
-//		printf("\n");
-//		printf("Enc. error: ");
-//		print_array(encoded, lenght_encoded);
-//		printf("\n");
-//
-//		length_decoded =  fec_decode_packet(encoded, lenght_encoded, decoded, 255);
-//
-//		printf("Decoded: ");
-//		print_array(decoded, length_decoded);
-//		printf("\n");
-//
-//		if (memcmp(input, decoded, input_length) == 0)
-//		{
-//			printf("ok\n");
-//		}
-//		else
-//		{
-//			printf("error\n");
-//			notrecovered++;
-//		}
-//
-//		nr_errors++;
-//	}
-
-
-    return 0;
+	uint32_t packets = DEFAULT_PACKETS;
+	uint32_t benchmark_bytes = DEFAULT_BENCHMARK_BYTES;
+	error_model_t models = ERROR_MODEL_ALL;
+	uint8_t burst_length = DEFAULT_BURST_LENGTH;
+
+	int option;
+	while ((option = getopt(argc, argv, "p:s:m:L:")) != -1)
+	{
+		switch (option)
+		{
+			case 'p':
+				packets = atoi(optarg);
+				break;
+			case 's':
+				benchmark_bytes = atoi(optarg);
+				break;
+			case 'm':
+				if (strcmp(optarg, "random") == 0)
+					models = ERROR_MODEL_RANDOM;
+				else if (strcmp(optarg, "burst") == 0)
+					models = ERROR_MODEL_BURST;
+				else
+					models = ERROR_MODEL_ALL;
+				break;
+			case 'L':
+				burst_length = atoi(optarg);
+				break;
+			default:
+				fprintf(stderr, "usage: %s [-p packets] [-s benchmark bytes] [-m random|burst|all] [-L burst length]\n", argv[0]);
+				return EXIT_FAILURE;
+		}
+	}
+
+	if (!check_round_trip())
+		return EXIT_FAILURE;
+
+	benchmark_throughput(benchmark_bytes);
+
+	printf("# ber, implementation, error model, channel BER, BER, PER (%d byte frames, %d per point)\n",
+		   BER_FRAME_LENGTH, packets);
+	if (models & ERROR_MODEL_RANDOM)
+		simulate_errors(ERROR_MODEL_RANDOM, packets, burst_length);
+
+	if (models & ERROR_MODEL_BURST)
+		simulate_errors(ERROR_MODEL_BURST, packets, burst_length);
+
+	return EXIT_SUCCESS;
 }
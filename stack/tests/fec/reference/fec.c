@@ -61,6 +61,20 @@ static bool fec_decode(uint8_t* input);
 #define DPRINT(...) printf(__VA_ARGS__)
 #define DPRINT_DATA(...) print_array(__VA_ARGS__)
 
+const char *byte_to_binary(uint8_t x)
+{
+    static char b[9];
+    b[0] = '\0';
+
+    uint8_t z;
+    for (z = 128; z > 0; z >>= 1)
+    {
+        strcat(b, ((x & z) == z) ? "1" : "0");
+    }
+
+    return b;
+}
+
 void print_array(uint8_t* buffer, uint8_t length, uint8_t binary)
 {
 	int i = 0;
@@ -0,0 +1,140 @@
+/* * OSS-7 - An opensource implementation of the DASH7 Alliance Protocol for ultra
+ * lowpower wireless sensor communication
+ *
+ * Copyright 2015 University of Antwerp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+ * Checks fec_rx_start(), fec_rx_decode() and fec_rx_finish(), which radio drivers (si4460.c) use to decode a packet in
+ * place while the RX FIFO is drained. The packet is received like in the driver, with the FIFO reads replaced by chunks
+ * of the encoded packet of the sizes the radio reports: the 4 byte header first and then between the almost full
+ * threshold and the size of the FIFO.
+ * Every frame length is received without errors, which should give the frame, and with random bit errors, which
+ * should give the same result as decoding the whole packet at once with fec_decode_packet().
+ * Usage: fec_rx_fifo [packets per frame length]
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fec.h"
+
+#define MAX_FRAME_LENGTH 255
+#define MAX_ENCODED_LENGTH (2 * (MAX_FRAME_LENGTH + 3))
+#define MAX_RECEIVED_LENGTH (MAX_ENCODED_LENGTH + RX_FIFO_SIZE)
+#define RX_FIFO_SIZE 64
+#define RX_FIFO_THRESHOLD 16  // PKT_RX_THRESHOLD in si4460_configuration.h
+#define BIT_ERROR_RATE 0.01
+#define DEFAULT_PACKETS 10
+
+static uint64_t random_state = 0x853C49E6748FEA9BULL;
+
+// xorshift64*, reproducible on every host
+static uint32_t get_random()
+{
+	random_state ^= random_state >> 12;
+	random_state ^= random_state << 25;
+	random_state ^= random_state >> 27;
+	return (random_state * 0x2545F4914F6CDD1DULL) >> 32;
+}
+
+static uint8_t rx_data[MAX_RECEIVED_LENGTH];
+static fec_rx_t fec_rx;
+
+// receives the encoded packet like the driver, returns the number of encoded bytes of the packet
+static uint16_t receive(const uint8_t* encoded)
+{
+	// the header, from which the length of the packet is known
+	uint8_t buffer[FEC_RX_HEADER_LENGTH];
+	memcpy(buffer, encoded, FEC_RX_HEADER_LENGTH);
+	uint16_t expected_data_length = fec_rx_start(&fec_rx, buffer);
+	memcpy(rx_data, buffer, FEC_RX_HEADER_LENGTH);
+	uint16_t rx_fifo_data_lenght = FEC_RX_HEADER_LENGTH;
+
+	// the RX FIFO almost full interrupts, the radio keeps receiving while the FIFO is read. The FIFO can hold more
+	// bytes than the packet: the encoded terminator of an odd length, or noise when the length was received wrong
+	while (rx_fifo_data_lenght < expected_data_length)
+	{
+		uint16_t count = RX_FIFO_THRESHOLD + get_random() % (RX_FIFO_SIZE - RX_FIFO_THRESHOLD + 1);
+		memcpy(&rx_data[rx_fifo_data_lenght], &encoded[rx_fifo_data_lenght], count);
+		rx_fifo_data_lenght += count;
+		fec_rx_decode(&fec_rx, rx_data, rx_fifo_data_lenght);
+	}
+
+	// the end of the packet
+	fec_rx_decode(&fec_rx, rx_data, rx_fifo_data_lenght);
+	fec_rx_finish(&fec_rx, rx_data);
+	return expected_data_length;
+}
+
+static void add_errors(uint8_t* data, uint16_t length)
+{
+	uint16_t i;
+	for (i = 0; i < length * 8; i++)
+		if (get_random() < BIT_ERROR_RATE * 4294967296.0)
+			data[i / 8] ^= 0x80 >> (i % 8);
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t packets = argc > 1 ? atoi(argv[1]) : DEFAULT_PACKETS;
+	uint32_t failures = 0;
+	uint16_t length;
+	for (length = 1; length <= MAX_FRAME_LENGTH; length++)
+	{
+		uint32_t n;
+		for (n = 0; n < packets; n++)
+		{
+			uint8_t frame[MAX_FRAME_LENGTH];
+			uint8_t encoded[MAX_RECEIVED_LENGTH];
+			uint16_t i;
+			frame[0] = length - 1;
+			for (i = 1; i < length; i++)
+				frame[i] = get_random();
+
+			memcpy(encoded, frame, length);
+			uint16_t encoded_length = fec_encode(encoded, length);
+			for (i = encoded_length; i < MAX_RECEIVED_LENGTH; i++)
+				encoded[i] = get_random();
+
+			// without errors
+			receive(encoded);
+			if (fec_rx.output_length < length || memcmp(rx_data, frame, length) != 0)
+			{
+				printf("receiving a %d byte frame failed (%d bytes decoded)\n", length, fec_rx.output_length);
+				failures++;
+				continue;
+			}
+
+			// with errors, compared with decoding the packet at once
+			add_errors(encoded, encoded_length);
+			uint16_t packet_length = receive(encoded);
+			uint8_t reference[MAX_ENCODED_LENGTH];
+			memcpy(reference, encoded, packet_length);
+			uint16_t reference_length = fec_decode_packet(reference, packet_length, packet_length);
+			if (fec_rx.output_length != reference_length || memcmp(rx_data, reference, reference_length) != 0)
+			{
+				printf("receiving a %d byte frame with errors differs from fec_decode_packet()\n", length);
+				failures++;
+			}
+		}
+	}
+
+	printf("%d frames received, %d failures\n", MAX_FRAME_LENGTH * packets, failures);
+	return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
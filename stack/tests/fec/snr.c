@@ -0,0 +1,163 @@
+/* * OSS-7 - An opensource implementation of the DASH7 Alliance Protocol for ultra
+ * lowpower wireless sensor communication
+ *
+ * Copyright 2015 University of Antwerp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+ * Measures the bit and packet error rates of the framework FEC decoder versus the SNR, for hard and soft decisions.
+ * The encoded packets are sent as antipodal symbols over an AWGN channel, the soft decisions are the received
+ * values quantized to 3 bits.
+ * Prints one line per Eb/N0: <Eb/N0 (dB)> <channel BER> <hard BER> <hard PER> <soft BER> <soft PER>
+ * Usage: fec_snr [packets per point]
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fec.h"
+
+#define PACKET_LENGTH 32
+#define ENCODED_LENGTH (2 * (PACKET_LENGTH + 2 + PACKET_LENGTH % 2))
+#define MIN_EBN0_DB 0
+#define MAX_EBN0_DB 8
+#define DEFAULT_PACKETS 1000
+
+static uint64_t random_state = 0x853C49E6748FEA9BULL;
+
+// xorshift64*, reproducible on every host
+static uint32_t get_random()
+{
+	random_state ^= random_state >> 12;
+	random_state ^= random_state << 25;
+	random_state ^= random_state >> 27;
+	return (random_state * 0x2545F4914F6CDD1DULL) >> 32;
+}
+
+static double get_gaussian()
+{
+	double u1 = (get_random() + 1.0) / 4294967297.0;
+	double u2 = get_random() / 4294967296.0;
+	return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+static uint32_t count_bit_errors(const uint8_t* a, const uint8_t* b, uint16_t length)
+{
+	uint32_t errors = 0;
+	uint16_t i;
+	for (i = 0; i < length; i++)
+		errors += __builtin_popcount(a[i] ^ b[i]);
+
+	return errors;
+}
+
+// the decoders should agree on a packet without noise
+static int check_noiseless()
+{
+	uint8_t data[ENCODED_LENGTH];
+	uint8_t hard[ENCODED_LENGTH];
+	uint8_t soft_bits[ENCODED_LENGTH * 8];
+	uint8_t soft[ENCODED_LENGTH];
+	uint16_t i;
+	for (i = 0; i < PACKET_LENGTH; i++)
+		data[i] = hard[i] = get_random();
+
+	uint16_t encoded_length = fec_encode(hard, PACKET_LENGTH);
+	for (i = 0; i < encoded_length * 8; i++)
+		soft_bits[i] = ((hard[i / 8] >> (7 - i % 8)) & 0x01) ? FEC_SOFT_BIT_MAX : 0;
+
+	fec_decode_packet(hard, encoded_length, encoded_length);
+	fec_decode_packet_soft(soft_bits, encoded_length, soft);
+	if (memcmp(data, hard, PACKET_LENGTH) != 0 || memcmp(data, soft, PACKET_LENGTH) != 0)
+	{
+		printf("decoding a packet without noise failed\n");
+		return 0;
+	}
+
+	return 1;
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t packets = argc > 1 ? atoi(argv[1]) : DEFAULT_PACKETS;
+	if (!check_noiseless())
+		return EXIT_FAILURE;
+
+	uint32_t total_hard_errors = 0;
+	uint32_t total_soft_errors = 0;
+
+	printf("# Eb/N0 (dB), channel BER, hard BER, hard PER, soft BER, soft PER (%d byte packets)\n", PACKET_LENGTH);
+	int ebn0_db;
+	for (ebn0_db = MIN_EBN0_DB; ebn0_db <= MAX_EBN0_DB; ebn0_db++)
+	{
+		// the symbol energy is the energy per data bit times the code rate
+		double code_rate = (double) PACKET_LENGTH * 8 / (ENCODED_LENGTH * 8);
+		double sigma = sqrt(1.0 / (2.0 * code_rate * pow(10.0, ebn0_db / 10.0)));
+		uint32_t channel_errors = 0, hard_errors = 0, soft_errors = 0;
+		uint32_t hard_packet_errors = 0, soft_packet_errors = 0;
+
+		uint32_t n;
+		for (n = 0; n < packets; n++)
+		{
+			uint8_t data[PACKET_LENGTH];
+			uint8_t encoded[ENCODED_LENGTH];
+			uint8_t hard[ENCODED_LENGTH];
+			uint8_t soft_bits[ENCODED_LENGTH * 8];
+			uint8_t soft[ENCODED_LENGTH];
+			uint16_t i;
+			for (i = 0; i < PACKET_LENGTH; i++)
+				data[i] = encoded[i] = get_random();
+
+			uint16_t encoded_length = fec_encode(encoded, PACKET_LENGTH);
+			memset(hard, 0, sizeof(hard));
+			for (i = 0; i < encoded_length * 8; i++)
+			{
+				uint8_t bit = (encoded[i / 8] >> (7 - i % 8)) & 0x01;
+				double received = (bit ? 1.0 : -1.0) + sigma * get_gaussian();
+				int level = (int) floor((received + 1.0) * FEC_SOFT_BIT_MAX / 2.0 + 0.5);
+				soft_bits[i] = level < 0 ? 0 : (level > FEC_SOFT_BIT_MAX ? FEC_SOFT_BIT_MAX : level);
+				if (received > 0)
+					hard[i / 8] |= 0x80 >> (i % 8);
+			}
+
+			channel_errors += count_bit_errors(encoded, hard, encoded_length);
+
+			fec_decode_packet(hard, encoded_length, encoded_length);
+			fec_decode_packet_soft(soft_bits, encoded_length, soft);
+
+			uint32_t errors = count_bit_errors(data, hard, PACKET_LENGTH);
+			hard_errors += errors;
+			hard_packet_errors += errors > 0;
+			errors = count_bit_errors(data, soft, PACKET_LENGTH);
+			soft_errors += errors;
+			soft_packet_errors += errors > 0;
+		}
+
+		double data_bits = (double) packets * PACKET_LENGTH * 8;
+		printf("%d %.3e %.3e %.3e %.3e %.3e\n", ebn0_db, channel_errors / (data_bits * ENCODED_LENGTH / PACKET_LENGTH),
+			   hard_errors / data_bits, (double) hard_packet_errors / packets,
+			   soft_errors / data_bits, (double) soft_packet_errors / packets);
+
+		total_hard_errors += hard_errors;
+		total_soft_errors += soft_errors;
+	}
+
+	// soft decisions should never do worse than hard decisions
+	return total_soft_errors <= total_hard_errors ? EXIT_SUCCESS : EXIT_FAILURE;
+}
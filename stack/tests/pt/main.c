@@ -0,0 +1,239 @@
+/* * OSS-7 - An opensource implementation of the DASH7 Alliance Protocol for ultra
+ * lowpower wireless sensor communication
+ *
+ * Copyright 2015 University of Antwerp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+ * Tests the resumption of protothreads by the scheduler and the timer: through a scheduler event, through a timer
+ * event and, when the scheduler is out of event records or the timer out of timers, through the retries of pt.c and
+ * timer.c. pt.c and timer.c run on a scheduler with EVENT_RECORDS event records and a hardware timer which are
+ * simulated here, the time only advances when the test calls run().
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "pt.h"
+#include "timer.h"
+#include "hwtimer.h"
+#include "hwatomic.h"
+
+#define EVENT_RECORDS 4
+#define TIMER_DELAY 10
+
+#define CHECK(condition, message)                                      \
+    do {                                                               \
+        if(!(condition)) {                                             \
+            printf("line %d: %s\n", __LINE__, message);                \
+            return 1;                                                  \
+        }                                                              \
+    } while(0)
+
+// the simulated hardware timer
+static uint32_t counter;
+static hwtimer_tick_t compare_value;
+static bool compare_armed;
+static timer_callback_t compare_callback;
+static timer_callback_t overflow_callback;
+
+error_t hw_timer_init(hwtimer_id_t timer_id, uint8_t frequency, timer_callback_t compare_cb, timer_callback_t overflow_cb)
+{
+    compare_callback = compare_cb;
+    overflow_callback = overflow_cb;
+    return SUCCESS;
+}
+
+hwtimer_tick_t hw_timer_getvalue(hwtimer_id_t timer_id) { return (hwtimer_tick_t)counter; }
+
+error_t hw_timer_schedule(hwtimer_id_t timer_id, hwtimer_tick_t tick)
+{
+    compare_value = tick;
+    compare_armed = true;
+    return SUCCESS;
+}
+
+error_t hw_timer_cancel(hwtimer_id_t timer_id)
+{
+    compare_armed = false;
+    return SUCCESS;
+}
+
+error_t hw_timer_counter_reset(hwtimer_id_t timer_id) { return SUCCESS; }
+bool hw_timer_is_overflow_pending(hwtimer_id_t id) { return false; }
+bool hw_timer_is_interrupt_pending(hwtimer_id_t id) { return false; }
+
+static void tick()
+{
+    counter++;
+    if((hwtimer_tick_t)counter == 0)
+        overflow_callback();
+
+    if(compare_armed && (hwtimer_tick_t)counter == compare_value)
+    {
+        compare_armed = false;
+        compare_callback();
+    }
+}
+
+// the simulated scheduler, which only handles events
+typedef struct
+{
+    event_handler_t handler;
+    void* arg;
+} event_t;
+
+static event_t events[EVENT_RECORDS];
+static uint8_t first_event;
+static uint8_t event_count;
+
+error_t sched_post_task_prio(task_t task, uint8_t priority) { return SUCCESS; }
+
+error_t sched_post_event_prio(event_handler_t handler, void* arg, uint8_t priority)
+{
+    if(event_count == EVENT_RECORDS)
+        return ENOMEM;
+
+    events[(first_event + event_count) % EVENT_RECORDS] = (event_t){ handler, arg };
+    event_count++;
+    return SUCCESS;
+}
+
+// handles the events which are pending, not the events they post
+static void handle_events()
+{
+    uint8_t count = event_count;
+    while(count-- > 0)
+    {
+        event_t event = events[first_event];
+        first_event = (first_event + 1) % EVENT_RECORDS;
+        event_count--;
+        event.handler(event.arg);
+    }
+}
+
+static void run(uint32_t ticks)
+{
+    handle_events();
+    while(ticks-- > 0)
+    {
+        tick();
+        handle_events();
+    }
+}
+
+void start_atomic() {}
+void end_atomic() {}
+
+void __assert_func(const char* file, int line, const char* function, const char* expression)
+{
+    printf("%s:%d: assertion %s failed\n", file, line, expression);
+    exit(EXIT_FAILURE);
+}
+
+static void dummy_event(void* arg) {}
+
+// takes all free event records, they are freed again by handle_events()
+static void fill_event_pool()
+{
+    while(sched_post_event_prio(&dummy_event, NULL, MAX_PRIORITY) == SUCCESS);
+}
+
+// the protothread under test, which records the step it reached
+static pt_t pt;
+static uint8_t step;
+
+static pt_state_t thread(pt_t* pt)
+{
+    PT_BEGIN(pt);
+    PT_AWAIT_DELAY(pt, TIMER_DELAY);
+    step = 1;
+    PT_YIELD(pt);
+    step = 2;
+    PT_AWAIT_SIGNAL(pt);
+    step = 3;
+    PT_AWAIT_DELAY(pt, TIMER_DELAY);
+    step = 4;
+    PT_END(pt);
+}
+
+static void start_thread()
+{
+    step = 0;
+    pt_start(&pt, &thread, MAX_PRIORITY);
+}
+
+int main(int argc, char** argv)
+{
+    timer_init();
+
+    // resumed through scheduler events (the start, the yield and the signal) and timer events
+    start_thread();
+    run(TIMER_DELAY - 1);
+    CHECK(step == 0, "the thread did not wait for its timer");
+    run(1);
+    CHECK(step == 1, "the thread was not resumed by its timer");
+    run(0);
+    CHECK(step == 2, "the thread was not resumed after yielding");
+    pt_signal(&pt);
+    run(0);
+    CHECK(step == 3, "the thread was not resumed by a signal");
+    run(TIMER_DELAY);
+    CHECK(step == 4 && !pt_is_running(&pt), "the thread did not end");
+
+    // signalled while the scheduler is out of event records: the event is posted by a timer once a record is free
+    start_thread();
+    run(TIMER_DELAY);
+    run(0);
+    CHECK(step == 2, "the thread did not wait for a signal");
+    fill_event_pool();
+    pt_signal(&pt);
+    for(uint8_t i = 0; i < TIMER_DELAY; i++)
+        tick();
+
+    CHECK(step == 2, "the thread was resumed without an event record");
+    run(1);
+    CHECK(step == 3, "the thread was not resumed after an event record was freed");
+
+    // the timer expires while the scheduler is out of event records: the timer retries to post its event
+    fill_event_pool();
+    for(uint8_t i = 0; i < 2 * TIMER_DELAY; i++)
+        tick();
+
+    CHECK(step == 3, "the timer of the thread posted an event without an event record");
+    run(1);
+    CHECK(step == 4 && !pt_is_running(&pt), "the thread was not resumed by its timer after an event record was freed");
+
+    // out of timers when the thread starts waiting: the thread polls until a timer is free and then waits for the
+    // time it was given
+    for(uintptr_t i = 0; i < FRAMEWORK_TIMER_STACK_SIZE; i++)
+        CHECK(timer_post_event_prio(&dummy_event, (void*)i, timer_get_counter_value() + 1000, MAX_PRIORITY) == SUCCESS,
+              "posting a timer failed");
+
+    timer_tick_t start = timer_get_counter_value();
+    start_thread();
+    run(TIMER_DELAY / 2);
+    CHECK(step == 0 && timer_get_counter_value() == start + TIMER_DELAY / 2, "the thread did not wait for a timer");
+    timer_cancel_event(&dummy_event, (void*)0);
+    run(TIMER_DELAY / 2 - 1);
+    CHECK(step == 0, "the thread did not wait for its timer");
+    run(1);
+    CHECK(step == 1, "the thread was not resumed by its timer after a timer was freed");
+    pt_stop(&pt);
+
+    printf("all protothread tests passed\n");
+    return 0;
+}
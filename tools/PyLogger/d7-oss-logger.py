@@ -291,6 +291,68 @@ class LogPhyPacketRx(Logs):
         return ""
 
 
+class LogTaskStats(Logs):
+    def __init__(self):
+        Logs.__init__(self, "taskstats")
+
+    def read(self):
+        self.handle = struct.unpack('B', serial_port.read(size=1))[0]
+        (self.runs, self.total_exec_time, self.max_exec_time,
+         self.total_latency, self.max_latency) = struct.unpack('IIIII', serial_port.read(size=20))
+        return self
+
+    def averages(self):
+        if self.runs == 0:
+            return (0, 0)
+        return (self.total_exec_time / self.runs, self.total_latency / self.runs)
+
+    def write(self):
+        avg_exec_time, avg_latency = self.averages()
+        return "TASK STATS: task " + str(self.handle) + " runs " + str(self.runs) \
+               + " exec avg " + str(avg_exec_time) + " max " + str(self.max_exec_time) \
+               + " latency avg " + str(avg_latency) + " max " + str(self.max_latency) + "\n"
+
+    def __str__(self):
+        avg_exec_time, avg_latency = self.averages()
+        string = formatHeader("TASK STATS", "CYAN", self.datetime) + "task " + str(self.handle) + " runs: " + str(self.runs) + "\n"
+        string += " " * 22 + "exec time avg: " + str(avg_exec_time) + " max: " + str(self.max_exec_time) + " ticks\n"
+        string += " " * 22 + "latency avg: " + str(avg_latency) + " max: " + str(self.max_latency) + " ticks"
+        string += Style.RESET_ALL
+        return string + "\n"
+
+
+class LogTimerStats(Logs):
+    def __init__(self):
+        Logs.__init__(self, "timerstats")
+
+    def read_latency(self, buckets):
+        (count, min_latency, max_latency) = struct.unpack('III', serial_port.read(size=12))
+        histogram = struct.unpack('I' * buckets, serial_port.read(size=4 * buckets))
+        return (count, min_latency, max_latency, histogram)
+
+    def read(self):
+        buckets = struct.unpack('B', serial_port.read(size=1))[0]
+        self.fire_latency = self.read_latency(buckets)
+        self.dispatch_latency = self.read_latency(buckets)
+        return self
+
+    def format_latency(self, name, latency):
+        (count, min_latency, max_latency, histogram) = latency
+        if count == 0:
+            min_latency = 0
+        return name + " latency count " + str(count) + " min " + str(min_latency) + " max " + str(max_latency) \
+               + " histogram " + " ".join(str(h) for h in histogram)
+
+    def write(self):
+        return "TIMER STATS: " + self.format_latency("fire", self.fire_latency) + " " \
+               + self.format_latency("dispatch", self.dispatch_latency) + "\n"
+
+    def __str__(self):
+        string = formatHeader("TIMER STATS", "CYAN", self.datetime) + self.format_latency("fire", self.fire_latency) + "\n"
+        string += " " * 22 + self.format_latency("dispatch", self.dispatch_latency) + " ticks"
+        string += Style.RESET_ALL
+        return string + "\n"
+
 
 ##
 # Different threads we use
@@ -392,6 +454,8 @@ def read_value_from_serial():
              "03" : LogStack(),
              "04" : LogPhyPacketTx(),
              "05" : LogPhyPacketRx(),
+             "06" : LogTaskStats(),
+             "07" : LogTimerStats(),
              #"FD" : log_dll_res.read,
              #"FE" : log_phy_res.read,
              "FF" : LogTrace(), }.get(logtype)